@@ -17,10 +17,40 @@
 #include "rpi_common.h"
 #include "rpi_regmap.h"
 
+/*------------------------------------------------------------------------------
+	Defined Macros
+------------------------------------------------------------------------------*/
+#define D_CLKGEN_CH_NUM		(3)		/**< number of clock generators (GPCLK0 - GPCLK2) */
+#define D_CLKGEN_DIVI_MAX	(4095)	/**< maximum of CM_GPnDIV.DIVI */
+#define D_CLKGEN_DIVF_NUM	(4096)	/**< denominator of CM_GPnDIV.DIVF */
+
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief status of clock generator */
+typedef struct t_clkgen_status {
+	uint8_t		ch;			/**< channel of clock manager */
+	uint8_t		enab;		/**< CM_GPnCTL.ENAB */
+	uint8_t		busy;		/**< CM_GPnCTL.BUSY */
+	uint32_t	src;		/**< CM_GPnCTL.SRC */
+	uint32_t	mash;		/**< CM_GPnCTL.MASH */
+	uint32_t	divi;		/**< CM_GPnDIV.DIVI */
+	uint32_t	divf;		/**< CM_GPnDIV.DIVF */
+	double		hz;			/**< output frequency [Hz] (0: not running) */
+	uint64_t	pins;		/**< GPIO pins assigned to the clock generator (bit n: GPIO pin n) */
+} T_CLKGEN_STATUS;
+
 /*------------------------------------------------------------------------------
 	Prototype Declaration
 ------------------------------------------------------------------------------*/
-void rpiClkgenEnable(uint8_t pin, uint32_t mash, uint32_t src, uint32_t divi, uint32_t divf);
-void rpiClkgenDisable(uint8_t pin);
+int8_t rpiClkgenEnable(uint8_t pin, uint32_t mash, uint32_t src, uint32_t divi, uint32_t divf);
+int8_t rpiClkgenDisable(uint8_t pin);
+int8_t rpiClkgenRetune(uint8_t pin, uint32_t divi, uint32_t divf);
+int8_t rpiClkgenSetTimeout(uint32_t timeout);
+int8_t rpiClkgenGetChannel(uint8_t pin, uint8_t *ch);
+int8_t rpiClkgenGetStatus(T_CLKGEN_STATUS *status, uint8_t num);
+int8_t rpiClkgenSetFrequency(uint8_t pin, double hz, double tolerance, double *actual);
+double rpiClkgenCalcFrequency(uint32_t src, uint32_t mash, uint32_t divi, uint32_t divf);
+int8_t rpiClkgenCheckDivisor(uint32_t mash, uint32_t divi, uint32_t divf);
 
 #endif /* __RPI_CLKGEN_H__ */
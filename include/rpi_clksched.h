@@ -0,0 +1,45 @@
+/**
+ * @file		rpi_clksched.h
+ * @brief		Clock Schedule Library Header
+ *
+ * @author		T. Ngtk
+ * @copyright	Copyright (c) 2016 T. Ngtk
+ *
+ * @par License
+ *	Released under the MIT License.<BR>
+ *	https://github.com/ngtkt0909/raspberry-pi-gpio/blob/master/LICENSE
+ */
+
+#ifndef __RPI_CLKSCHED_H__
+#define __RPI_CLKSCHED_H__		/**< include guard */
+
+#include <stdint.h>
+#include "rpi_common.h"
+#include "rpi_clkgen.h"
+
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief schedule entry */
+typedef struct t_clksched_entry {
+	uint64_t	time;		/**< time from start of schedule [nsec] */
+	uint32_t	divi;		/**< integer part of divisor */
+	uint32_t	divf;		/**< fractional part of divisor */
+} T_CLKSCHED_ENTRY;
+
+/** @brief result of schedule */
+typedef struct t_clksched_result {
+	uint32_t	num;			/**< number of written entries */
+	uint32_t	max_late_idx;	/**< index of the latest entry */
+	uint64_t	max_late;		/**< worst-case lateness [nsec] */
+	uint64_t	sum_late;		/**< sum of lateness [nsec] */
+} T_CLKSCHED_RESULT;
+
+/*------------------------------------------------------------------------------
+	Prototype Declaration
+------------------------------------------------------------------------------*/
+int8_t rpiClkschedStart(uint8_t pin, const T_CLKSCHED_ENTRY *entries, uint32_t num, int32_t priority);
+int8_t rpiClkschedWait(uint8_t pin, T_CLKSCHED_RESULT *result);
+int8_t rpiClkschedStop(uint8_t pin, T_CLKSCHED_RESULT *result);
+
+#endif /* __RPI_CLKSCHED_H__ */
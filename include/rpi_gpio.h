@@ -13,17 +13,55 @@
 #ifndef __RPI_GPIO_H__
 #define __RPI_GPIO_H__		/**< include guard */
 
+#include <stddef.h>
 #include <stdint.h>
 #include "rpi_common.h"
 
+/*------------------------------------------------------------------------------
+	Defined Macros
+------------------------------------------------------------------------------*/
+#define D_GPIO_DIR_IN			(0U)				/**< input direction */
+#define D_GPIO_DIR_OUT			(1U)				/**< output direction */
+
+#define D_GPIO_EDGE_NONE		(0U)				/**< no edge detection */
+#define D_GPIO_EDGE_RISING		(1U)				/**< rising edge detection */
+#define D_GPIO_EDGE_FALLING		(2U)				/**< falling edge detection */
+#define D_GPIO_EDGE_BOTH		(3U)				/**< both edges detection */
+
+#define D_GPIO_BACKEND_SYSFS	(0U)				/**< sysfs (/sys/class/gpio) */
+#define D_GPIO_BACKEND_CDEV		(1U)				/**< GPIO character device (/dev/gpiochipN) */
+
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief GPIO edge event */
+typedef struct t_gpio_event {
+	uint8_t		pin;			/**< number of GPIO pin */
+	int32_t		level;			/**< pin level after the edge (0 or 1) */
+	uint64_t	timestamp;		/**< time of detection (nsec, CLOCK_MONOTONIC by default) */
+} T_GPIO_EVENT;
+
 /*------------------------------------------------------------------------------
 	Prototype Declaration
 ------------------------------------------------------------------------------*/
 int8_t rpiGpioOpenIn(uint8_t pin);
 int8_t rpiGpioOpenOut(uint8_t pin);
 int8_t rpiGpioClose(uint8_t pin);
+int8_t rpiGpioOpenMany(const uint8_t *pins, const uint8_t *dirs, size_t n, int8_t *results);
+int8_t rpiGpioCloseMany(const uint8_t *pins, size_t n, int8_t *results);
 int8_t rpiGpioSet(uint8_t pin);
 int8_t rpiGpioClr(uint8_t pin);
 int8_t rpiGpioGet(uint8_t pin, int32_t *val);
+int8_t rpiGpioWriteMany(const uint8_t *pins, const uint8_t *vals, size_t n);
+int8_t rpiGpioReadMany(const uint8_t *pins, int32_t *vals, size_t n);
+int8_t rpiGpioSetBackend(uint8_t backend);
+int8_t rpiGpioSetChip(const char *chip_path);
+int8_t rpiGpioSetTimeout(uint32_t timeout);
+int8_t rpiGpioSetEdge(uint8_t pin, uint8_t edge);
+int8_t rpiGpioGetFd(uint8_t pin, int *fd);
+int8_t rpiGpioReadEvent(uint8_t pin, T_GPIO_EVENT *event);
+int8_t rpiGpioEventAdd(uint8_t pin);
+int8_t rpiGpioEventDel(uint8_t pin);
+int8_t rpiGpioEventWait(T_GPIO_EVENT *events, uint32_t max, int32_t timeout, uint32_t *num);
 
 #endif /* __RPI_GPIO_H__ */
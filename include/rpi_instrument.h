@@ -0,0 +1,149 @@
+/**
+ * @file		rpi_instrument.h
+ * @brief		Instrumentation Library Header
+ *
+ * @author		T. Ngtk
+ * @copyright	Copyright (c) 2016 T. Ngtk
+ *
+ * @par License
+ *	Released under the MIT License.<BR>
+ *	https://github.com/ngtkt0909/raspberry-pi-gpio/blob/master/LICENSE
+ */
+
+#ifndef __RPI_INSTRUMENT_H__
+#define __RPI_INSTRUMENT_H__		/**< include guard */
+
+#include <stdint.h>
+#include "rpi_common.h"
+
+/*------------------------------------------------------------------------------
+	Defined Macros
+------------------------------------------------------------------------------*/
+#define D_INSTRUMENT_SHM_NAME		"/rpi_instrument.%d"	/**< name of shared memory (%d: process ID) */
+#define D_INSTRUMENT_MAGIC			(0x52504949)			/**< magic number of shared memory ("RPII") */
+#define D_INSTRUMENT_VERSION		(1)						/**< layout version of shared memory */
+#define D_INSTRUMENT_HIST_BINS		(32)					/**< number of latency histogram bins (bin n: 2^n - 2^(n+1)-1 ns) */
+#define D_INSTRUMENT_NAME_SIZE		(24)					/**< maximum string length of entry point name */
+#define D_INSTRUMENT_CH_NUM			(3)						/**< number of clock manager channels */
+
+/* registers (0-11: configuration registers, refer to M_RPI_SLOT_XXX() of rpi_regmap.h, which checks the number) */
+#define D_INSTRUMENT_REG_CFG_NUM		(12)								/**< number of configuration registers */
+#define D_INSTRUMENT_REG_GPSET(bank)	(D_INSTRUMENT_REG_CFG_NUM + (bank))		/**< register index of GPSETn */
+#define D_INSTRUMENT_REG_GPCLR(bank)	(D_INSTRUMENT_REG_CFG_NUM + 2 + (bank))	/**< register index of GPCLRn */
+#define D_INSTRUMENT_REG_GPLEV(bank)	(D_INSTRUMENT_REG_CFG_NUM + 4 + (bank))	/**< register index of GPLEVn */
+#define D_INSTRUMENT_REG_NUM			(D_INSTRUMENT_REG_CFG_NUM + 6)			/**< number of registers */
+
+/** entry point table: X(id, name) */
+#define M_INSTRUMENT_FUNCS(X) \
+	X(GPIO_OPEN_IN,			"rpiGpioOpenIn") \
+	X(GPIO_OPEN_OUT,		"rpiGpioOpenOut") \
+	X(GPIO_CLOSE,			"rpiGpioClose") \
+	X(GPIO_OPEN_MANY,		"rpiGpioOpenMany") \
+	X(GPIO_CLOSE_MANY,		"rpiGpioCloseMany") \
+	X(GPIO_SET,				"rpiGpioSet") \
+	X(GPIO_CLR,				"rpiGpioClr") \
+	X(GPIO_GET,				"rpiGpioGet") \
+	X(GPIO_WRITE_MANY,		"rpiGpioWriteMany") \
+	X(GPIO_READ_MANY,		"rpiGpioReadMany") \
+	X(GPIO_READ_EVENT,		"rpiGpioReadEvent") \
+	X(GPIO_EVENT_WAIT,		"rpiGpioEventWait") \
+	X(I2C_OPEN,				"rpiI2cOpen") \
+	X(I2C_CLOSE,			"rpiI2cClose") \
+	X(I2C_SET_SLAVE,		"rpiI2cSetSlave") \
+	X(I2C_WRITE,			"rpiI2cWrite") \
+	X(I2C_READ,				"rpiI2cRead") \
+	X(I2C_WRITE_BLOCK,		"rpiI2cWriteBlock") \
+	X(I2C_READ_BLOCK,		"rpiI2cReadBlock") \
+	X(SPI_OPEN,				"rpiSpiOpen") \
+	X(SPI_CLOSE,			"rpiSpiClose") \
+	X(SPI_TRANSFER,			"rpiSpiTransfer") \
+	X(SPI_TRANSFER_BATCH,	"rpiSpiTransferBatch") \
+	X(SPI_SET_MODE,			"rpiSpiSetMode") \
+	X(SPI_PROFILE_SELECT,	"rpiSpiProfileSelect") \
+	X(REGMAP_INIT,			"rpiRegmapInit") \
+	X(REGMAP_FINAL,			"rpiRegmapFinal") \
+	X(REGMAP_TXN_COMMIT,	"rpiRegmapTxnCommit")
+
+#define M_INSTRUMENT_GEN_ID(id, name)	D_INSTRUMENT_FN_##id,		/**< generate ID of entry point */
+
+#ifdef RPI_INSTRUMENT
+/** measure latency of the enclosing function (put at the top of function body) */
+#define M_INSTRUMENT_FUNC(id) \
+	T_INSTRUMENT_SCOPE instrument_scope __attribute__((cleanup(rpiInstrumentScopeEnd))) = \
+		{D_INSTRUMENT_FN_##id, rpiInstrumentNow()}
+
+/** count read of register */
+#define M_INSTRUMENT_REG_READ(reg)		rpiInstrumentCount(&g_instrument_data->reg_read[reg])
+
+/** count write of register */
+#define M_INSTRUMENT_REG_WRITE(reg)		rpiInstrumentCount(&g_instrument_data->reg_write[reg])
+
+/** count busy-wait spin of clock manager channel */
+#define M_INSTRUMENT_SPIN(ch)			rpiInstrumentCount(&g_instrument_data->spin[ch])
+#else
+#define M_INSTRUMENT_FUNC(id)
+#define M_INSTRUMENT_REG_READ(reg)
+#define M_INSTRUMENT_REG_WRITE(reg)
+#define M_INSTRUMENT_SPIN(ch)
+#endif
+
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief IDs of entry points */
+enum {
+	M_INSTRUMENT_FUNCS(M_INSTRUMENT_GEN_ID)
+	D_INSTRUMENT_FN_NUM			/**< number of entry points */
+};
+
+/** @brief instrumentation data (layout of shared memory) */
+typedef struct t_instrument_data {
+	uint32_t	magic;											/**< D_INSTRUMENT_MAGIC */
+	uint32_t	version;										/**< D_INSTRUMENT_VERSION */
+	uint32_t	reg_num;										/**< D_INSTRUMENT_REG_NUM */
+	uint32_t	fn_num;											/**< D_INSTRUMENT_FN_NUM */
+	uint64_t	reg_read[D_INSTRUMENT_REG_NUM];					/**< number of register reads */
+	uint64_t	reg_write[D_INSTRUMENT_REG_NUM];				/**< number of register writes */
+	uint64_t	spin[D_INSTRUMENT_CH_NUM];						/**< number of CM_GPnCTL.BUSY polls */
+	uint64_t	calls[D_INSTRUMENT_FN_NUM];						/**< number of calls */
+	uint64_t	hist[D_INSTRUMENT_FN_NUM][D_INSTRUMENT_HIST_BINS];	/**< latency histogram */
+	char		name[D_INSTRUMENT_FN_NUM][D_INSTRUMENT_NAME_SIZE];	/**< names of entry points */
+} T_INSTRUMENT_DATA;
+
+/** @brief latency measurement scope */
+typedef struct t_instrument_scope {
+	uint32_t	id;			/**< ID of entry point */
+	uint64_t	start;		/**< start time [ns] */
+} T_INSTRUMENT_SCOPE;
+
+#ifdef RPI_INSTRUMENT
+/*------------------------------------------------------------------------------
+	Global Variables
+------------------------------------------------------------------------------*/
+extern T_INSTRUMENT_DATA *g_instrument_data;
+
+/*------------------------------------------------------------------------------
+	Prototype Declaration
+------------------------------------------------------------------------------*/
+T_INSTRUMENT_DATA *rpiInstrumentData();
+void rpiInstrumentReset();
+uint64_t rpiInstrumentNow();
+void rpiInstrumentScopeEnd(T_INSTRUMENT_SCOPE *scope);
+
+/*------------------------------------------------------------------------------
+	Inline Functions
+------------------------------------------------------------------------------*/
+/**
+ * @brief Count Up
+ *
+ * @param [in,out]	counter		counter
+ *
+ * @return nothing
+ */
+static inline void rpiInstrumentCount(uint64_t *counter)
+{
+	__atomic_fetch_add(counter, 1U, __ATOMIC_RELAXED);
+}
+#endif
+
+#endif /* __RPI_INSTRUMENT_H__ */
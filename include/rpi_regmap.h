@@ -13,15 +13,26 @@
 #ifndef __RPI_REGMAP_H__
 #define __RPI_REGMAP_H__		/**< include guard */
 
+#include <stddef.h>
+#include <sched.h>
 #include <stdint.h>
 #include "rpi_common.h"
+#include "rpi_instrument.h"
 
 /*------------------------------------------------------------------------------
 	Defined Macros
 ------------------------------------------------------------------------------*/
-#define D_RPI_BASE_GPIO					(0x3F200000)		/**< base address of GPIO */
-#define D_RPI_BASE_CM					(0x3F101000)		/**< base address of clock manager */
+#define D_RPI_BASE_PERI					(0x3F000000)		/**< default base address of peripherals (BCM2836/7) */
+#define D_RPI_OFFSET_GPIO				(0x00200000)		/**< offset of GPIO from base of peripherals */
+#define D_RPI_OFFSET_CM					(0x00101000)		/**< offset of clock manager from base of peripherals */
+#define D_RPI_BASE_GPIO					(D_RPI_BASE_PERI + D_RPI_OFFSET_GPIO)	/**< default base address of GPIO */
+#define D_RPI_BASE_CM					(D_RPI_BASE_PERI + D_RPI_OFFSET_CM)		/**< default base address of clock manager */
 #define D_RPI_BLOCK_SIZE				(4096)				/**< block size for mmap */
+#define D_RPI_WINDOW_SIZE				(D_RPI_OFFSET_GPIO + D_RPI_BLOCK_SIZE - D_RPI_OFFSET_CM)
+															/**< window size for mmap (clock manager - GPIO) */
+
+#define D_RPI_BLOCK_GPIO				(0x01)				/**< GPIO block is mapped */
+#define D_RPI_BLOCK_CM					(0x02)				/**< clock manager block is mapped */
 
 #define D_RPI_BASE_GPFSEL				(g_regmap_base_gpio + 0x00)		/**< GPIO Function Select */
 #define D_RPI_BASE_GPSET				(g_regmap_base_gpio + 0x1C)		/**< GPIO Pin Output Set */
@@ -40,6 +51,9 @@
 #define D_RPI_BASE_CMGPDIV				(g_regmap_base_cm   + 0x74)		/**< Clock Manager General Purpose Clock Divisors */
 
 #define M_RPI_ADDR_GPFSEL(pin)			(((uint32_t *)D_RPI_BASE_GPFSEL) + ((pin) / 10))	/**< address of GPFSEL */
+#define M_RPI_ADDR_GPSET(bank)			(((uint32_t *)D_RPI_BASE_GPSET) + (bank))			/**< address of GPSETn */
+#define M_RPI_ADDR_GPCLR(bank)			(((uint32_t *)D_RPI_BASE_GPCLR) + (bank))			/**< address of GPCLRn */
+#define M_RPI_ADDR_GPLEV(bank)			(((uint32_t *)D_RPI_BASE_GPLEV) + (bank))			/**< address of GPLEVn */
 #define M_RPI_ADDR_CMGPCTL(ch)			(((uint32_t *)D_RPI_BASE_CMGPCTL) + ((ch) << 1))	/**< address of CM_GPnCTL */
 #define M_RPI_ADDR_CMGPDIV(ch)			(((uint32_t *)D_RPI_BASE_CMGPDIV) + ((ch) << 1))	/**< address of CM_GPnDIV */
 
@@ -64,6 +78,81 @@
 #define D_RPI_MASK_CMGPDIV_DIVI			(0x00FFF000)		/**< mask of CM_GPnDIV.DIVI */
 #define D_RPI_MASK_CMGPDIV_DIVF			(0x00000FFF)		/**< mask of CM_GPnDIV.DIVF */
 
+#define M_RPI_GPIO_BANK(pin)			((pin) >> 5)		/**< bank of GPIO pin (0: pin 0-31, 1: pin 32-53) */
+#define M_RPI_GPIO_BIT(pin)				(1U << ((pin) & 0x1F))
+															/**< bit of GPIO pin in GPSETn/GPCLRn/GPLEVn */
+
+#define D_RPI_SLOT_NUM					(12)				/**< number of configuration registers (slots) */
+#define M_RPI_SLOT_GPFSEL(pin)			((pin) / 10)		/**< slot of GPFSEL (0-5) */
+#define M_RPI_SLOT_CMGPDIV(ch)			(6 + (ch))			/**< slot of CM_GPnDIV (6-8) */
+#define M_RPI_SLOT_CMGPCTL(ch)			(9 + (ch))			/**< slot of CM_GPnCTL (9-11) */
+
+/* instrumentation counts accesses of configuration registers by slot */
+_Static_assert(D_INSTRUMENT_REG_CFG_NUM == D_RPI_SLOT_NUM, "D_INSTRUMENT_REG_CFG_NUM must be D_RPI_SLOT_NUM");
+
+#define D_RPI_SHADOW_OFF				(0)					/**< shadow cache is not used */
+#define D_RPI_SHADOW_ON					(1)					/**< configuration registers are served from shadow cache */
+#define D_RPI_SHADOW_VALIDATE			(2)					/**< registers are read and compared with shadow cache */
+
+#define M_RPI_FIELD_PASSWD(passwd)		((uint32_t)(passwd) << 24)		/**< password field of value to be written */
+#define M_RPI_FIELD_PASSWD_MASK(passwd)	((passwd) ? 0xFF000000U : 0U)	/**< password field of mask */
+
+/**
+ * @brief register field table
+ *
+ * X(name, address, slot, shift amount, mask, password, access)<BR>
+ * Address, slot, shift amount and mask are expressions of 'idx' (pin or channel),
+ * so that each accessor folds to a single load/store for a constant 'idx'.
+ * Read-only (RO) fields are status bits, so they are always read from the register.
+ */
+#define M_RPI_REGMAP_FIELDS(X) \
+	X(GpfselFsel,	M_RPI_ADDR_GPFSEL(idx),		M_RPI_SLOT_GPFSEL(idx),		M_RPI_SHAMT_GPFSEL_FSEL(idx),	M_RPI_MASK_GPFSEL_FSEL(idx),	0,						RW) \
+	X(CmGpctlMash,	M_RPI_ADDR_CMGPCTL(idx),	M_RPI_SLOT_CMGPCTL(idx),	D_RPI_SHAMT_CMGPCTL_MASH,		D_RPI_MASK_CMGPCTL_MASH,		D_RPI_CMGPCTL_PASSWD,	RW) \
+	X(CmGpctlBusy,	M_RPI_ADDR_CMGPCTL(idx),	M_RPI_SLOT_CMGPCTL(idx),	D_RPI_SHAMT_CMGPCTL_BUSY,		D_RPI_MASK_CMGPCTL_BUSY,		D_RPI_CMGPCTL_PASSWD,	RO) \
+	X(CmGpctlEnab,	M_RPI_ADDR_CMGPCTL(idx),	M_RPI_SLOT_CMGPCTL(idx),	D_RPI_SHAMT_CMGPCTL_ENAB,		D_RPI_MASK_CMGPCTL_ENAB,		D_RPI_CMGPCTL_PASSWD,	RW) \
+	X(CmGpctlSrc,	M_RPI_ADDR_CMGPCTL(idx),	M_RPI_SLOT_CMGPCTL(idx),	D_RPI_SHAMT_CMGPCTL_SRC,		D_RPI_MASK_CMGPCTL_SRC,			D_RPI_CMGPCTL_PASSWD,	RW) \
+	X(CmGpdivDivi,	M_RPI_ADDR_CMGPDIV(idx),	M_RPI_SLOT_CMGPDIV(idx),	D_RPI_SHAMT_CMGPDIV_DIVI,		D_RPI_MASK_CMGPDIV_DIVI,		D_RPI_CMGPDIV_PASSWD,	RW) \
+	X(CmGpdivDivf,	M_RPI_ADDR_CMGPDIV(idx),	M_RPI_SLOT_CMGPDIV(idx),	D_RPI_SHAMT_CMGPDIV_DIVF,		D_RPI_MASK_CMGPDIV_DIVF,		D_RPI_CMGPDIV_PASSWD,	RW)
+
+/** generate inline reader of register field (rpiRegmapReadXxx) */
+#define M_RPI_REGMAP_GEN_READ(name, addr, slot, shamt, mask, passwd, access) \
+	static inline uint32_t rpiRegmapRead##name(uint8_t idx) \
+	{ \
+		M_INSTRUMENT_REG_READ(slot); \
+		return (M_RPI_REGMAP_LOAD_##access(addr, slot) & (mask)) >> (shamt); \
+	}
+#define M_RPI_REGMAP_LOAD_RO(addr, slot)	rpiRegmapRawRead(addr)
+#define M_RPI_REGMAP_LOAD_RW(addr, slot)	rpiRegmapShadowLoad(addr, slot)
+
+/** generate inline writer of register field (rpiRegmapWriteXxx, read-write fields only) */
+#define M_RPI_REGMAP_GEN_WRITE(name, addr, slot, shamt, mask, passwd, access) \
+	M_RPI_REGMAP_GEN_WRITE_##access(name, addr, slot, shamt, mask, passwd)
+#define M_RPI_REGMAP_GEN_WRITE_RO(name, addr, slot, shamt, mask, passwd)
+#define M_RPI_REGMAP_GEN_WRITE_RW(name, addr, slot, shamt, mask, passwd) \
+	static inline void rpiRegmapWrite##name(uint8_t idx, uint32_t val) \
+	{ \
+		volatile uint32_t *reg = (addr); \
+		uint32_t upd; \
+		M_INSTRUMENT_REG_WRITE(slot); \
+		rpiRegmapLock(slot); \
+		upd = ((val << (shamt)) & (mask)) | \
+			  (rpiRegmapShadowLoad(reg, slot) & ~((uint32_t)(mask) | M_RPI_FIELD_PASSWD_MASK(passwd))); \
+		rpiRegmapRawWrite(reg, M_RPI_FIELD_PASSWD(passwd) | upd); \
+		rpiRegmapShadowStore(slot, upd); \
+		rpiRegmapUnlock(slot); \
+	}
+
+/** generate inline queuing function of register field for transaction (rpiRegmapQueueXxx, read-write fields only) */
+#define M_RPI_REGMAP_GEN_QUEUE(name, addr, slot, shamt, mask, passwd, access) \
+	M_RPI_REGMAP_GEN_QUEUE_##access(name, slot, shamt, mask)
+#define M_RPI_REGMAP_GEN_QUEUE_RO(name, f_slot, f_shamt, f_mask)
+#define M_RPI_REGMAP_GEN_QUEUE_RW(name, f_slot, f_shamt, f_mask) \
+	static inline void rpiRegmapQueue##name(T_RPI_REGMAP_TXN *txn, uint8_t idx, uint32_t val) \
+	{ \
+		txn->mask[f_slot] |= (f_mask); \
+		txn->val[f_slot] = (txn->val[f_slot] & ~(uint32_t)(f_mask)) | ((val << (f_shamt)) & (f_mask)); \
+	}
+
 /* GPFSEL.FSEL */
 #define D_RPI_GPFSEL_FSEL_INPUT			(0x0)				/**< GPIO Pin is an input */
 #define D_RPI_GPFSEL_FSEL_OUTPUT		(0x1)				/**< GPIO Pin is an output */
@@ -104,11 +193,67 @@
 /* CM_GPnDIV.PASSWD */
 #define D_RPI_CMGPDIV_PASSWD			(0x5A)				/**< clock manager password */
 
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief register map session handle (initialize with zero) */
+typedef struct t_rpi_regmap_session {
+	uint8_t	acquired;		/**< acquired or not */
+} T_RPI_REGMAP_SESSION;
+
+/** @brief register transaction (field updates merged per register) */
+typedef struct t_rpi_regmap_txn {
+	uint32_t	mask[D_RPI_SLOT_NUM];	/**< bit mask of queued fields */
+	uint32_t	val[D_RPI_SLOT_NUM];	/**< value of queued fields */
+} T_RPI_REGMAP_TXN;
+
+/** @brief write log of simulated registers */
+typedef struct t_rpi_regmap_log {
+	uint64_t			time;		/**< time of write (CLOCK_MONOTONIC) [nsec] */
+	volatile uint32_t	*addr;		/**< address of register */
+	uint32_t			val;		/**< written value */
+} T_RPI_REGMAP_LOG;
+
+/** @brief register write hook */
+typedef void (*T_RPI_REGMAP_HOOK)(volatile uint32_t *addr, uint32_t val);
+
+/*------------------------------------------------------------------------------
+	Global Variables
+------------------------------------------------------------------------------*/
+extern volatile uint8_t *g_regmap_base_gpio;
+extern volatile uint8_t *g_regmap_base_cm;
+extern T_RPI_REGMAP_HOOK g_regmap_hook;
+extern uint32_t g_regmap_shadow[D_RPI_SLOT_NUM];
+extern uint8_t g_regmap_shadow_mode;
+extern uint8_t g_regmap_lock[D_RPI_SLOT_NUM];
+extern uint8_t g_regmap_lock_enabled;
+
 /*------------------------------------------------------------------------------
 	Prototype Declaration
 ------------------------------------------------------------------------------*/
 int8_t rpiRegmapInit();
 int8_t rpiRegmapFinal();
+int8_t rpiRegmapAcquire(T_RPI_REGMAP_SESSION *session);
+int8_t rpiRegmapRelease(T_RPI_REGMAP_SESSION *session);
+int8_t rpiRegmapInitSim(const char *path);
+void rpiRegmapSetHook(T_RPI_REGMAP_HOOK hook);
+void rpiRegmapSimWrite(volatile uint32_t *addr, uint32_t val);
+void rpiRegmapSimSetLog(T_RPI_REGMAP_LOG *log, uint32_t max);
+uint32_t rpiRegmapSimGetLogNum();
+int8_t rpiRegmapDetectBase(const char *dt_dir, uint32_t *base);
+uint32_t rpiRegmapGetBase();
+uint8_t rpiRegmapGetBlocks();
+
+int8_t rpiRegmapShadowEnable(uint8_t mode);
+int8_t rpiRegmapShadowResync();
+int8_t rpiRegmapShadowValidate(uint16_t *mismatch);
+void rpiRegmapShadowCheck(uint8_t slot, uint32_t val);
+uint32_t rpiRegmapShadowGetErrors();
+
+void rpiRegmapLockEnable(uint8_t enable);
+
+void rpiRegmapTxnBegin(T_RPI_REGMAP_TXN *txn);
+int8_t rpiRegmapTxnCommit(const T_RPI_REGMAP_TXN *txn);
 
 void rpiRegmapSetGpfselFsel(uint8_t pin, uint32_t fsel);
 void rpiRegmapSetCmGpctlMash(uint8_t ch, uint32_t mash);
@@ -117,7 +262,12 @@ void rpiRegmapSetCmGpctlSrc(uint8_t ch, uint32_t src);
 void rpiRegmapSetCmGpdivDivi(uint8_t ch, uint32_t divi);
 void rpiRegmapSetCmGpdivDivf(uint8_t ch, uint32_t divf);
 
+void rpiRegmapSetGpset(uint8_t bank, uint32_t mask);
+void rpiRegmapSetGpclr(uint8_t bank, uint32_t mask);
+
 uint32_t rpiRegmapGetGpfselFsel(uint8_t pin);
+uint32_t rpiRegmapGetGplev(uint8_t bank);
+uint64_t rpiRegmapGetGplevAll();
 uint32_t rpiRegmapGetCmGpctlMash(uint8_t ch);
 uint32_t rpiRegmapGetCmGpctlBusy(uint8_t ch);
 uint32_t rpiRegmapGetCmGpctlEnab(uint8_t ch);
@@ -125,4 +275,155 @@ uint32_t rpiRegmapGetCmGpctlSrc(uint8_t ch);
 uint32_t rpiRegmapGetCmGpdivDivi(uint8_t ch);
 uint32_t rpiRegmapGetCmGpdivDivf(uint8_t ch);
 
+/*------------------------------------------------------------------------------
+	Inline Functions
+------------------------------------------------------------------------------*/
+/**
+ * @brief Read Register
+ *
+ * @param [in]	addr	address of register
+ *
+ * @return value of register
+ */
+static inline uint32_t rpiRegmapRawRead(volatile uint32_t *addr)
+{
+	return *addr;
+}
+
+/**
+ * @brief Write Register
+ *
+ * @param [in]	addr	address of register
+ * @param [in]	val		value to be written
+ *
+ * @return nothing
+ */
+static inline void rpiRegmapRawWrite(volatile uint32_t *addr, uint32_t val)
+{
+	if (__builtin_expect(g_regmap_hook != NULL, 0)) {
+		g_regmap_hook(addr, val);
+	} else {
+		*addr = val;
+	}
+}
+
+/**
+ * @brief Load Configuration Register (through shadow cache)
+ *
+ * @param [in]	addr	address of register
+ * @param [in]	slot	slot of register
+ *
+ * @return value of register (password field is not included in shadow cache)
+ */
+static inline uint32_t rpiRegmapShadowLoad(volatile uint32_t *addr, uint8_t slot)
+{
+	uint32_t val;
+
+	if (g_regmap_shadow_mode == D_RPI_SHADOW_ON) {
+		return g_regmap_shadow[slot];
+	}
+
+	val = rpiRegmapRawRead(addr);
+	if (g_regmap_shadow_mode == D_RPI_SHADOW_VALIDATE) {
+		rpiRegmapShadowCheck(slot, val);
+	}
+
+	return val;
+}
+
+/**
+ * @brief Store Configuration Register Value to Shadow Cache
+ *
+ * @param [in]	slot	slot of register
+ * @param [in]	val		value written to register (without password field)
+ *
+ * @return nothing
+ */
+static inline void rpiRegmapShadowStore(uint8_t slot, uint32_t val)
+{
+	if (g_regmap_shadow_mode != D_RPI_SHADOW_OFF) {
+		g_regmap_shadow[slot] = val;
+	}
+}
+
+/**
+ * @brief Lock Configuration Register (concurrency-safe mode only)
+ *
+ * @param [in]	slot	slot of register
+ *
+ * @return nothing
+ */
+static inline void rpiRegmapLock(uint8_t slot)
+{
+	if (g_regmap_lock_enabled) {
+		while (__atomic_test_and_set(&g_regmap_lock[slot], __ATOMIC_ACQUIRE)) {
+			while (__atomic_load_n(&g_regmap_lock[slot], __ATOMIC_RELAXED)) {
+				sched_yield();		/* holder may be preempted on single core */
+			}
+		}
+	}
+}
+
+/**
+ * @brief Unlock Configuration Register (concurrency-safe mode only)
+ *
+ * @param [in]	slot	slot of register
+ *
+ * @return nothing
+ */
+static inline void rpiRegmapUnlock(uint8_t slot)
+{
+	if (g_regmap_lock_enabled) {
+		__atomic_clear(&g_regmap_lock[slot], __ATOMIC_RELEASE);
+	}
+}
+
+/* rpiRegmapReadXxx(idx) / rpiRegmapWriteXxx(idx, val) (no parameter check) */
+M_RPI_REGMAP_FIELDS(M_RPI_REGMAP_GEN_READ)
+M_RPI_REGMAP_FIELDS(M_RPI_REGMAP_GEN_WRITE)
+
+/* rpiRegmapQueueXxx(txn, idx, val) (no parameter check) */
+M_RPI_REGMAP_FIELDS(M_RPI_REGMAP_GEN_QUEUE)
+
+/**
+ * @brief Write GPSETn (no parameter check)
+ *
+ * @param [in]	bank	bank of GPIO pin
+ * @param [in]	mask	bit mask of GPIO pins (refer to M_RPI_GPIO_BIT())
+ *
+ * @return nothing
+ */
+static inline void rpiRegmapWriteGpset(uint8_t bank, uint32_t mask)
+{
+	M_INSTRUMENT_REG_WRITE(D_INSTRUMENT_REG_GPSET(bank));
+	rpiRegmapRawWrite(M_RPI_ADDR_GPSET(bank), mask);
+}
+
+/**
+ * @brief Write GPCLRn (no parameter check)
+ *
+ * @param [in]	bank	bank of GPIO pin
+ * @param [in]	mask	bit mask of GPIO pins (refer to M_RPI_GPIO_BIT())
+ *
+ * @return nothing
+ */
+static inline void rpiRegmapWriteGpclr(uint8_t bank, uint32_t mask)
+{
+	M_INSTRUMENT_REG_WRITE(D_INSTRUMENT_REG_GPCLR(bank));
+	rpiRegmapRawWrite(M_RPI_ADDR_GPCLR(bank), mask);
+}
+
+/**
+ * @brief Read GPLEVn (no parameter check)
+ *
+ * @param [in]	bank	bank of GPIO pin
+ *
+ * @return levels of GPIO pins (bit n: level of GPIO pin (32 * bank + n))
+ */
+static inline uint32_t rpiRegmapReadGplev(uint8_t bank)
+{
+	M_INSTRUMENT_REG_READ(D_INSTRUMENT_REG_GPLEV(bank));
+	return rpiRegmapRawRead(M_RPI_ADDR_GPLEV(bank));
+}
+
 #endif /* __RPI_REGMAP_H__ */
@@ -22,6 +22,37 @@
 ------------------------------------------------------------------------------*/
 #define D_SPI_CS_POS_LOGIC		(1U)				/**< CS Positive Logic */
 #define D_SPI_CS_NEG_LOGIC		(0U)				/**< CS Negative Logic */
+#define D_SPI_PROFILE_NUM		(8)					/**< maximum number of profiles of a handle */
+#define D_SPI_PROFILE_NAME		(16)				/**< maximum string length for name of profile (including '\0') */
+
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief segment of batched transfer */
+typedef struct t_spi_segment {
+	uint8_t		*tx;			/**< address of write data buffer (NULL: read only) */
+	uint8_t		*rx;			/**< address of read data buffer (NULL: write only) */
+	uint32_t	len;			/**< buffer size */
+	uint32_t	speed;			/**< transfer speed (0: rpiSpiSetSpeed() value) */
+	uint16_t	delay;			/**< delay after the segment [usec] */
+	uint8_t		bits;			/**< bits per word (0: rpiSpiSetBitsPerWord() value) */
+	uint8_t		cs_change;		/**< deassert CS after the segment (1) or not (0) (ignored by rpiSpiDevSubmit()) */
+} T_SPI_SEGMENT;
+
+/** @brief configuration profile */
+typedef struct t_spi_profile {
+	uint8_t		mode;			/**< SPI mode (SPI_MODE_0 - SPI_MODE_3) */
+	uint32_t	speed;			/**< transfer speed [Hz] */
+	uint16_t	delay;			/**< transfer delay time [usec] */
+	uint8_t		bits_per_word;	/**< bits per word */
+	uint8_t		cs_polarity;	/**< CS polarity (D_SPI_CS_POS_LOGIC or D_SPI_CS_NEG_LOGIC) */
+} T_SPI_PROFILE;
+
+/** @brief SPI device handle (opaque) */
+typedef struct t_spi_dev T_SPI_DEV;
+
+/** @brief completion callback of asynchronous transfer (called by worker thread) */
+typedef void (*T_SPI_CALLBACK)(T_SPI_DEV *dev, const T_SPI_SEGMENT *seg, int8_t result, void *arg);
 
 /*------------------------------------------------------------------------------
 	Prototype Declaration
@@ -29,10 +60,37 @@
 int8_t rpiSpiOpen(uint8_t *dev_name);
 int8_t rpiSpiClose();
 int8_t rpiSpiTransfer(uint8_t *tx_data, uint8_t *rx_data, uint32_t size);
+int8_t rpiSpiWrite(uint8_t *tx_data, uint32_t size);
+int8_t rpiSpiRead(uint8_t *rx_data, uint32_t size);
+int8_t rpiSpiTransferBatch(const T_SPI_SEGMENT *segs, uint32_t num);
 int8_t rpiSpiSetMode(uint8_t mode);
 int8_t rpiSpiSetSpeed(uint32_t speed);
 int8_t rpiSpiSetDelay(uint16_t delay);
 int8_t rpiSpiSetBitsPerWord(uint8_t len);
 int8_t rpiSpiSetCsPolarity(uint8_t pol);
+int8_t rpiSpiBufAcquire(uint8_t **buf, uint32_t *size);
+int8_t rpiSpiBufRelease(uint8_t *buf);
+int8_t rpiSpiProfileAdd(const char *name, const T_SPI_PROFILE *profile);
+int8_t rpiSpiProfileSelect(const char *name);
+
+int8_t rpiSpiDevOpen(uint8_t *dev_path, T_SPI_DEV **dev);
+int8_t rpiSpiDevClose(T_SPI_DEV *dev);
+int8_t rpiSpiDevTransfer(T_SPI_DEV *dev, uint8_t *tx_data, uint8_t *rx_data, uint32_t size);
+int8_t rpiSpiDevWrite(T_SPI_DEV *dev, uint8_t *tx_data, uint32_t size);
+int8_t rpiSpiDevRead(T_SPI_DEV *dev, uint8_t *rx_data, uint32_t size);
+int8_t rpiSpiDevTransferBatch(T_SPI_DEV *dev, const T_SPI_SEGMENT *segs, uint32_t num);
+int8_t rpiSpiDevSetMode(T_SPI_DEV *dev, uint8_t mode);
+int8_t rpiSpiDevSetSpeed(T_SPI_DEV *dev, uint32_t speed);
+int8_t rpiSpiDevSetDelay(T_SPI_DEV *dev, uint16_t delay);
+int8_t rpiSpiDevSetBitsPerWord(T_SPI_DEV *dev, uint8_t len);
+int8_t rpiSpiDevSetCsPolarity(T_SPI_DEV *dev, uint8_t pol);
+int8_t rpiSpiDevProfileAdd(T_SPI_DEV *dev, const char *name, const T_SPI_PROFILE *profile);
+int8_t rpiSpiDevProfileSelect(T_SPI_DEV *dev, const char *name);
+int8_t rpiSpiDevAsyncStart(T_SPI_DEV *dev, uint32_t depth);
+int8_t rpiSpiDevAsyncStop(T_SPI_DEV *dev);
+int8_t rpiSpiDevSubmit(T_SPI_DEV *dev, const T_SPI_SEGMENT *seg, T_SPI_CALLBACK callback, void *arg);
+int rpiSpiDevGetEventFd(T_SPI_DEV *dev);
+int8_t rpiSpiDevBufAcquire(T_SPI_DEV *dev, uint8_t **buf, uint32_t *size);
+int8_t rpiSpiDevBufRelease(T_SPI_DEV *dev, uint8_t *buf);
 
 #endif /* __RPI_SPI_H__ */
@@ -10,7 +10,11 @@
  *	https://github.com/ngtkt0909/raspberry-pi-gpio/blob/master/LICENSE
  */
 
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
 #include <assert.h>
+#include <pthread.h>
 #include "rpi_clkgen.h"
 
 /*------------------------------------------------------------------------------
@@ -21,6 +25,13 @@
 #define D_CH_GPCLK1		(1)			/**< channel number of GPCLK1 */
 #define D_CH_GPCLK2		(2)			/**< channel number of GPCLK2 */
 
+#define D_CLKGEN_CACHE_NUM	(8)			/**< number of cached frequency solutions */
+#define D_BASE_BCM2711		(0xFE000000)	/**< peripheral base address of BCM2711 */
+#define D_TIMEOUT_BUSY		(100000)		/**< default timeout of CM_GPnCTL.BUSY [usec] */
+#define D_SPIN_BUSY			(1000)			/**< number of polls before sleeping */
+#define D_SLEEP_MIN_BUSY	(1000)			/**< minimum sleep between polls [nsec] */
+#define D_SLEEP_MAX_BUSY	(1000000)		/**< maximum sleep between polls [nsec] */
+
 /** check number of GPIO pin */
 #define M_CHECK_PIN(pin)	((pin >= 0) && (pin <= 53))
 
@@ -45,6 +56,26 @@ typedef struct t_clkgen_gpio_map {
 	uint8_t	fsel;		/**< alternate function for clock manager */
 } T_CLKGEN_GPIO_MAP;
 
+/** @brief clock source */
+typedef struct t_clkgen_src {
+	uint32_t	src;		/**< clock source (CM_GPnCTL.SRC) */
+	double		bcm2837;	/**< frequency on BCM2835/6/7 [Hz] */
+	double		bcm2711;	/**< frequency on BCM2711 [Hz] */
+	uint8_t		search;		/**< searched by rpiClkgenSetFrequency() (0: no, 1: yes) */
+} T_CLKGEN_SRC;
+
+/** @brief frequency solution */
+typedef struct t_clkgen_plan {
+	double		hz;			/**< requested frequency [Hz] */
+	double		tolerance;	/**< requested tolerance [Hz] */
+	uint32_t	base;		/**< peripheral base address (SoC) */
+	uint32_t	src;		/**< clock source */
+	uint32_t	mash;		/**< MASH control */
+	uint32_t	divi;		/**< integer part of divisor */
+	uint32_t	divf;		/**< fractional part of divisor */
+	double		actual;		/**< achieved (average) frequency [Hz] */
+} T_CLKGEN_PLAN;
+
 /*------------------------------------------------------------------------------
 	Global Variables
 ------------------------------------------------------------------------------*/
@@ -106,12 +137,55 @@ const T_CLKGEN_GPIO_MAP g_clkgen_gpio_ch_map[] = {
 	{D_CH_INVALID,	D_RPI_GPFSEL_FSEL_INPUT},		/* GPIO pin 53 */
 };
 
+/**
+ * usable clock sources (in order of preference)
+ * PLLC follows the core clock (nominal frequency only), so it is not searched.
+ */
+static const T_CLKGEN_SRC g_clkgen_src[] = {
+	{D_RPI_CMGPCTL_SRC_PLLD,	500000000.0,	750000000.0,	1U},
+	{D_RPI_CMGPCTL_SRC_PLLC,	1000000000.0,	1000000000.0,	0U},
+	{D_RPI_CMGPCTL_SRC_OSC,		19200000.0,		54000000.0,		1U},
+};
+
+/** minimum of CM_GPnDIV.DIVI for each MASH control */
+static const uint32_t g_clkgen_divi_min[] = {
+	1U,		/* D_RPI_CMGPCTL_MASH_INT */
+	2U,		/* D_RPI_CMGPCTL_MASH_1STAGE */
+	3U,		/* D_RPI_CMGPCTL_MASH_2STAGE */
+	5U,		/* D_RPI_CMGPCTL_MASH_3STAGE */
+};
+
+/** cache of frequency solutions */
+static T_CLKGEN_PLAN g_clkgen_cache[D_CLKGEN_CACHE_NUM];
+static uint8_t g_clkgen_cache_num  = 0U;		/**< number of cached solutions */
+static uint8_t g_clkgen_cache_next = 0U;		/**< next entry to be replaced */
+static pthread_mutex_t g_clkgen_cache_lock = PTHREAD_MUTEX_INITIALIZER;	/**< lock of the cache */
+
+/** timeout of CM_GPnCTL.BUSY waits [usec] */
+static uint32_t g_clkgen_timeout = D_TIMEOUT_BUSY;
+
+/** register map session (acquired at the first use, never released) */
+static T_RPI_REGMAP_SESSION g_clkgen_session = {0U};
+
+/*------------------------------------------------------------------------------
+	Prototype Declaration
+------------------------------------------------------------------------------*/
+static int8_t sRpiClkgenMap();
+static int8_t sRpiClkgenPlan(double hz, double tolerance, T_CLKGEN_PLAN *plan);
+static double sRpiClkgenSrcFrequency(uint32_t src);
+static int8_t sRpiClkgenWaitBusy(uint8_t ch, uint32_t busy);
+static int8_t sRpiClkgenWriteDiv(uint8_t ch, uint32_t divi, uint32_t divf);
+static uint64_t sRpiClkgenNow();
+
 /*------------------------------------------------------------------------------
 	Functions
 ------------------------------------------------------------------------------*/
 /**
  * @brief Enable Clock Generator
  *
+ * If the clock generator is running with the same source and MASH control,
+ * only the divisor is updated in place (refer to rpiClkgenRetune()).
+ *
  * @param [in]	pin		number of GPIO pin
  *		@arg 0-53	GPIO pin 0 - GPIO pin 53
  * @param [in]	mash	MASH control
@@ -128,13 +202,16 @@ const T_CLKGEN_GPIO_MAP g_clkgen_gpio_ch_map[] = {
  *		@arg D_RPI_CMGPCTL_SRC_PLLC		PLLC per
  *		@arg D_RPI_CMGPCTL_SRC_PLLD		PLLD per
  *		@arg D_RPI_CMGPCTL_SRC_HDMI		HDMI auxiliary
- * @param [in]	divi	integer part of divisor
+ * @param [in]	divi	integer part of divisor (refer to rpiClkgenCheckDivisor())
  * @param [in]	divf	fractional part of divisor
  *
- * @return nothing
+ * @retval E_OK		success
+ * @retval E_PAR	failure (divisor is out of range of the MASH control)
+ * @retval E_OBJ	failure (object error, e.g. timeout of CM_GPnCTL.BUSY)
  */
-void rpiClkgenEnable(uint8_t pin, uint32_t mash, uint32_t src, uint32_t divi, uint32_t divf)
+int8_t rpiClkgenEnable(uint8_t pin, uint32_t mash, uint32_t src, uint32_t divi, uint32_t divf)
 {
+	T_RPI_REGMAP_TXN txn;
 	uint8_t ch, fsel;
 	int8_t ret;
 
@@ -144,29 +221,42 @@ void rpiClkgenEnable(uint8_t pin, uint32_t mash, uint32_t src, uint32_t divi, ui
 	fsel = g_clkgen_gpio_ch_map[pin].fsel;
 	assert(M_CHECK_CH(ch));
 	assert(M_CHECK_FSEL(fsel));
+	if (rpiClkgenCheckDivisor(mash, divi, divf) != E_OK) {
+		return E_PAR;
+	}
+
+	/* map registers */
+	if ((ret = sRpiClkgenMap()) != E_OK) {
+		return ret;
+	}
 
-	/* initialize register map */
-	ret = rpiRegmapInit();
-	assert(ret == E_OK);
+	/* only divisor changes: retune without stop/start */
+	if ((rpiRegmapGetCmGpctlEnab(ch) == D_RPI_CMGPCTL_ENAB_ON) &&
+		(rpiRegmapGetCmGpctlMash(ch) == mash) && (rpiRegmapGetCmGpctlSrc(ch) == src) &&
+		(rpiRegmapGetGpfselFsel(pin) == fsel)) {
+		return sRpiClkgenWriteDiv(ch, divi, divf);
+	}
 
 	/* disable clock generator */
 	rpiRegmapSetCmGpctlEnab(ch, D_RPI_CMGPCTL_ENAB_OFF);
-	while (rpiRegmapGetCmGpctlBusy(ch) == D_RPI_CMGPCTL_BUSY_ON);
+	if ((ret = sRpiClkgenWaitBusy(ch, D_RPI_CMGPCTL_BUSY_OFF)) != E_OK) {
+		return ret;
+	}
 
-	/* set parameters */
-	rpiRegmapSetGpfselFsel(pin, fsel);
-	rpiRegmapSetCmGpctlMash(ch, mash);
-	rpiRegmapSetCmGpctlSrc(ch, src);
-	rpiRegmapSetCmGpdivDivi(ch, divi);
-	rpiRegmapSetCmGpdivDivf(ch, divf);
+	/* set parameters (one store per register) */
+	rpiRegmapTxnBegin(&txn);
+	rpiRegmapQueueGpfselFsel(&txn, pin, fsel);
+	rpiRegmapQueueCmGpctlMash(&txn, ch, mash);
+	rpiRegmapQueueCmGpctlSrc(&txn, ch, src);
+	rpiRegmapQueueCmGpdivDivi(&txn, ch, divi);
+	rpiRegmapQueueCmGpdivDivf(&txn, ch, divf);
+	if ((ret = rpiRegmapTxnCommit(&txn)) != E_OK) {
+		return ret;
+	}
 
 	/* enable clock generator */
 	rpiRegmapSetCmGpctlEnab(ch, D_RPI_CMGPCTL_ENAB_ON);
-	while (rpiRegmapGetCmGpctlBusy(ch) == D_RPI_CMGPCTL_BUSY_OFF);
-
-	/* finalize register map */
-	ret = rpiRegmapFinal();
-	assert(ret == E_OK);
+	return sRpiClkgenWaitBusy(ch, D_RPI_CMGPCTL_BUSY_ON);
 }
 
 /**
@@ -175,10 +265,12 @@ void rpiClkgenEnable(uint8_t pin, uint32_t mash, uint32_t src, uint32_t divi, ui
  * @param [in]	pin		number of GPIO pin
  *		@arg 0-53	GPIO pin 0 - GPIO pin 53
  *
- * @return nothing
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error, e.g. timeout of CM_GPnCTL.BUSY)
  */
-void rpiClkgenDisable(uint8_t pin)
+int8_t rpiClkgenDisable(uint8_t pin)
 {
+	T_RPI_REGMAP_TXN txn;
 	uint8_t ch;
 	int8_t ret;
 
@@ -187,22 +279,477 @@ void rpiClkgenDisable(uint8_t pin)
 	ch = g_clkgen_gpio_ch_map[pin].ch;
 	assert(M_CHECK_CH(ch));
 
-	/* initialize register map */
-	ret = rpiRegmapInit();
-	assert(ret == E_OK);
+	/* map registers */
+	if ((ret = sRpiClkgenMap()) != E_OK) {
+		return ret;
+	}
 
 	/* disable clock generator */
 	rpiRegmapSetCmGpctlEnab(ch, D_RPI_CMGPCTL_ENAB_OFF);
-	while (rpiRegmapGetCmGpctlBusy(ch) == D_RPI_CMGPCTL_BUSY_ON);
-
-	/* reset parameters */
-	rpiRegmapSetGpfselFsel(pin, D_RPI_GPFSEL_FSEL_INPUT);
-	rpiRegmapSetCmGpctlMash(ch, D_RPI_CMGPCTL_MASH_INT);
-	rpiRegmapSetCmGpctlSrc(ch, D_RPI_CMGPCTL_SRC_GND);
-	rpiRegmapSetCmGpdivDivi(ch, 0U);
-	rpiRegmapSetCmGpdivDivf(ch, 0U);
-
-	/* finalize register map */
-	ret = rpiRegmapFinal();
-	assert(ret == E_OK);
+	if ((ret = sRpiClkgenWaitBusy(ch, D_RPI_CMGPCTL_BUSY_OFF)) != E_OK) {
+		return ret;
+	}
+
+	/* reset parameters (one store per register) */
+	rpiRegmapTxnBegin(&txn);
+	rpiRegmapQueueGpfselFsel(&txn, pin, D_RPI_GPFSEL_FSEL_INPUT);
+	rpiRegmapQueueCmGpctlMash(&txn, ch, D_RPI_CMGPCTL_MASH_INT);
+	rpiRegmapQueueCmGpctlSrc(&txn, ch, D_RPI_CMGPCTL_SRC_GND);
+	rpiRegmapQueueCmGpdivDivi(&txn, ch, 0U);
+	rpiRegmapQueueCmGpdivDivf(&txn, ch, 0U);
+	return rpiRegmapTxnCommit(&txn);
+}
+
+/**
+ * @brief Retune Running Clock Generator
+ *
+ * Writes DIVI and DIVF by one store while the clock generator is running,
+ * without the stop/start cycle of rpiClkgenEnable().
+ * The clock generator takes the new divisor from its next cycle.
+ *
+ * @param [in]	pin		number of GPIO pin
+ *		@arg 0-53	GPIO pin 0 - GPIO pin 53
+ * @param [in]	divi	integer part of divisor (minimum of current MASH control - 4095)
+ * @param [in]	divf	fractional part of divisor (0 - 4095)
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (divisor is out of range of current MASH control)
+ * @retval E_OBJ	failure (object error, e.g. clock generator is not running)
+ */
+int8_t rpiClkgenRetune(uint8_t pin, uint32_t divi, uint32_t divf)
+{
+	uint8_t ch;
+	int8_t ret;
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	ch = g_clkgen_gpio_ch_map[pin].ch;
+	assert(M_CHECK_CH(ch));
+
+	/* map registers */
+	if ((ret = sRpiClkgenMap()) != E_OK) {
+		return ret;
+	}
+
+	if (rpiRegmapGetCmGpctlEnab(ch) != D_RPI_CMGPCTL_ENAB_ON) {
+		fprintf(stderr, "clock generator is not running\n");
+		return E_OBJ;
+	}
+	if (rpiClkgenCheckDivisor(rpiRegmapGetCmGpctlMash(ch), divi, divf) != E_OK) {
+		return E_PAR;
+	}
+
+	return sRpiClkgenWriteDiv(ch, divi, divf);
+}
+
+/**
+ * @brief Getter of Clock Manager Channel
+ *
+ * @param [in]	pin		number of GPIO pin
+ *		@arg 0-53	GPIO pin 0 - GPIO pin 53
+ * @param [out]	ch		channel of clock manager (GPCLK0 - GPCLK2)
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (GPIO pin has no clock generator)
+ */
+int8_t rpiClkgenGetChannel(uint8_t pin, uint8_t *ch)
+{
+	/* check parameter */
+	assert(ch != NULL);
+	if (!M_CHECK_PIN(pin) || !M_CHECK_CH(g_clkgen_gpio_ch_map[pin].ch)) {
+		return E_PAR;
+	}
+
+	*ch = g_clkgen_gpio_ch_map[pin].ch;
+
+	return E_OK;
+}
+
+/**
+ * @brief Getter of Status of Clock Generators
+ *
+ * Reads each CM_GPnCTL, CM_GPnDIV and GPFSEL register once from the persistent mapping
+ * (the mapping is created only by the first call of the library).
+ *
+ * @param [out]	status	status of GPCLK0 - GPCLK(num - 1)
+ * @param [in]	num		number of elements of status (up to D_CLKGEN_CH_NUM are filled)
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiClkgenGetStatus(T_CLKGEN_STATUS *status, uint8_t num)
+{
+	uint32_t fsel[M_RPI_SLOT_GPFSEL(53) + 1];
+	uint32_t ctl, div;
+	uint8_t ch, pin, slot;
+	int8_t ret;
+
+	/* check parameter */
+	assert(status != NULL);
+
+	/* map registers */
+	if ((ret = sRpiClkgenMap()) != E_OK) {
+		return ret;
+	}
+
+	/* GPFSEL0 - GPFSEL5 */
+	for (slot = M_RPI_SLOT_GPFSEL(0); slot <= M_RPI_SLOT_GPFSEL(53); slot++) {
+		fsel[slot] = rpiRegmapRawRead(M_RPI_ADDR_GPFSEL(slot * 10));
+	}
+
+	for (ch = 0; (ch < num) && (ch < D_CLKGEN_CH_NUM); ch++) {
+		ctl = rpiRegmapRawRead(M_RPI_ADDR_CMGPCTL(ch));
+		div = rpiRegmapRawRead(M_RPI_ADDR_CMGPDIV(ch));
+
+		status[ch].ch   = ch;
+		status[ch].enab = (ctl & D_RPI_MASK_CMGPCTL_ENAB) >> D_RPI_SHAMT_CMGPCTL_ENAB;
+		status[ch].busy = (ctl & D_RPI_MASK_CMGPCTL_BUSY) >> D_RPI_SHAMT_CMGPCTL_BUSY;
+		status[ch].src  = (ctl & D_RPI_MASK_CMGPCTL_SRC)  >> D_RPI_SHAMT_CMGPCTL_SRC;
+		status[ch].mash = (ctl & D_RPI_MASK_CMGPCTL_MASH) >> D_RPI_SHAMT_CMGPCTL_MASH;
+		status[ch].divi = (div & D_RPI_MASK_CMGPDIV_DIVI) >> D_RPI_SHAMT_CMGPDIV_DIVI;
+		status[ch].divf = (div & D_RPI_MASK_CMGPDIV_DIVF) >> D_RPI_SHAMT_CMGPDIV_DIVF;
+		status[ch].hz   = (status[ch].busy == D_RPI_CMGPCTL_BUSY_ON) ?
+						  rpiClkgenCalcFrequency(status[ch].src, status[ch].mash, status[ch].divi, status[ch].divf) : 0.0;
+
+		/* pins whose alternate function is this clock generator */
+		status[ch].pins = 0U;
+		for (pin = 0; pin < sizeof(g_clkgen_gpio_ch_map) / sizeof(g_clkgen_gpio_ch_map[0]); pin++) {
+			if ((g_clkgen_gpio_ch_map[pin].ch == ch) &&
+				(((fsel[M_RPI_SLOT_GPFSEL(pin)] & M_RPI_MASK_GPFSEL_FSEL(pin)) >> M_RPI_SHAMT_GPFSEL_FSEL(pin)) ==
+				 g_clkgen_gpio_ch_map[pin].fsel)) {
+				status[ch].pins |= 1ULL << pin;
+			}
+		}
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief Set Timeout of CM_GPnCTL.BUSY Waits
+ *
+ * @param [in]	timeout	timeout [usec] (default: 100msec)
+ *
+ * @retval E_OK		success
+ */
+int8_t rpiClkgenSetTimeout(uint32_t timeout)
+{
+	g_clkgen_timeout = timeout;
+
+	return E_OK;
+}
+
+/**
+ * @brief Enable Clock Generator at Frequency
+ *
+ * Searches PLLD and oscillator with every MASH control for the divisor
+ * within the tolerance, preferring lower MASH stages (less jitter) and then lower error.
+ * PLLC is not searched since its frequency follows the core clock.
+ * Solutions are cached, so retuning to the same frequency does not search again.
+ * The cache is shared by threads under a lock.
+ *
+ * @param [in]	pin			number of GPIO pin
+ *		@arg 0-53	GPIO pin 0 - GPIO pin 53
+ * @param [in]	hz			frequency [Hz]
+ * @param [in]	tolerance	tolerance of frequency [Hz]
+ * @param [out]	actual		achieved (average) frequency [Hz] (NULL: not used)
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (no divisor within the tolerance, actual is the nearest one)
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiClkgenSetFrequency(uint8_t pin, double hz, double tolerance, double *actual)
+{
+	T_CLKGEN_PLAN plan;
+	int8_t ret;
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(M_CHECK_CH(g_clkgen_gpio_ch_map[pin].ch));
+	assert(hz > 0.0);
+	assert(tolerance >= 0.0);
+
+	/* map registers (source frequencies depend on SoC) */
+	if ((ret = sRpiClkgenMap()) != E_OK) {
+		return ret;
+	}
+
+	/* search divisor */
+	ret = sRpiClkgenPlan(hz, tolerance, &plan);
+	if (actual != NULL) {
+		*actual = plan.actual;
+	}
+	if (ret != E_OK) {
+		return ret;
+	}
+
+	return rpiClkgenEnable(pin, plan.mash, plan.src, plan.divi, plan.divf);
+}
+
+/**
+ * @brief Calculate Frequency of Clock Generator
+ *
+ * @param [in]	src		clock source
+ * @param [in]	mash	MASH control
+ * @param [in]	divi	integer part of divisor
+ * @param [in]	divf	fractional part of divisor
+ *
+ * @return (average) frequency [Hz] (0: source is not usable or divisor is 0)
+ */
+double rpiClkgenCalcFrequency(uint32_t src, uint32_t mash, uint32_t divi, uint32_t divf)
+{
+	double div = (double)divi;
+
+	if (mash != D_RPI_CMGPCTL_MASH_INT) {
+		div += (double)divf / D_CLKGEN_DIVF_NUM;
+	}
+
+	return (div > 0.0) ? (sRpiClkgenSrcFrequency(src) / div) : 0.0;
+}
+
+/**
+ * @brief Check Divisor of Clock Generator
+ *
+ * @param [in]	mash	MASH control
+ * @param [in]	divi	integer part of divisor (minimum of MASH control - 4095)
+ *		@arg 1-4095	integer division
+ *		@arg 2-4095	1-stage MASH
+ *		@arg 3-4095	2-stage MASH
+ *		@arg 5-4095	3-stage MASH
+ * @param [in]	divf	fractional part of divisor (0 - 4095)
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (MASH control or divisor is out of range)
+ */
+int8_t rpiClkgenCheckDivisor(uint32_t mash, uint32_t divi, uint32_t divf)
+{
+	if ((mash > D_RPI_CMGPCTL_MASH_3STAGE) || (divi < g_clkgen_divi_min[mash]) ||
+		(divi > D_CLKGEN_DIVI_MAX) || (divf >= D_CLKGEN_DIVF_NUM)) {
+		return E_PAR;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief Map Registers for Clock Generator
+ *
+ * The session is kept for the life of the process, so only the first call
+ * opens /dev/mem.
+ *
+ * @param nothing
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiClkgenMap()
+{
+	int8_t ret;
+
+	if (!g_clkgen_session.acquired) {
+		if ((ret = rpiRegmapAcquire(&g_clkgen_session)) != E_OK) {
+			return ret;
+		}
+	}
+
+	/* clock manager is not accessible via /dev/gpiomem */
+	if (!(rpiRegmapGetBlocks() & D_RPI_BLOCK_CM)) {
+		fprintf(stderr, "clock manager is not mapped (root privilege required)\n");
+		return E_OBJ;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief Search Divisor for Frequency
+ *
+ * @param [in]	hz			frequency [Hz]
+ * @param [in]	tolerance	tolerance of frequency [Hz]
+ * @param [out]	plan		solution (the nearest one on failure)
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (no divisor within the tolerance)
+ */
+static int8_t sRpiClkgenPlan(double hz, double tolerance, T_CLKGEN_PLAN *plan)
+{
+	T_CLKGEN_PLAN cand;
+	uint32_t base = rpiRegmapGetBase();
+	double div, err, best_err = INFINITY;
+	uint8_t i, found = 0U;
+
+	/* cached solution */
+	pthread_mutex_lock(&g_clkgen_cache_lock);
+	for (i = 0; i < g_clkgen_cache_num; i++) {
+		if ((g_clkgen_cache[i].hz == hz) && (g_clkgen_cache[i].tolerance == tolerance) &&
+			(g_clkgen_cache[i].base == base)) {
+			*plan = g_clkgen_cache[i];
+			found = 1U;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&g_clkgen_cache_lock);
+	if (found) {
+		return E_OK;
+	}
+
+	cand.hz        = hz;
+	cand.tolerance = tolerance;
+	cand.base      = base;
+	*plan          = cand;
+	plan->actual   = 0.0;
+
+	/* lower MASH stage first: less jitter */
+	for (cand.mash = D_RPI_CMGPCTL_MASH_INT; cand.mash <= D_RPI_CMGPCTL_MASH_3STAGE; cand.mash++) {
+		for (i = 0; i < sizeof(g_clkgen_src) / sizeof(g_clkgen_src[0]); i++) {
+			if (!g_clkgen_src[i].search) {
+				continue;
+			}
+			cand.src = g_clkgen_src[i].src;
+			div = sRpiClkgenSrcFrequency(cand.src) / hz;
+			if (div >= D_CLKGEN_DIVI_MAX + 1) {
+				continue;
+			}
+
+			if (cand.mash == D_RPI_CMGPCTL_MASH_INT) {
+				cand.divi = (uint32_t)lround(div);
+				cand.divf = 0U;
+			} else {
+				cand.divi = (uint32_t)floor(div);
+				cand.divf = (uint32_t)lround((div - floor(div)) * D_CLKGEN_DIVF_NUM);
+				if (cand.divf == D_CLKGEN_DIVF_NUM) {
+					cand.divi++;
+					cand.divf = 0U;
+				}
+				if (cand.divf == 0U) {
+					continue;		/* integer division is better */
+				}
+			}
+			if ((cand.divi < g_clkgen_divi_min[cand.mash]) || (cand.divi > D_CLKGEN_DIVI_MAX)) {
+				continue;
+			}
+
+			cand.actual = rpiClkgenCalcFrequency(cand.src, cand.mash, cand.divi, cand.divf);
+			err = fabs(cand.actual - hz);
+			if (err < best_err) {
+				best_err = err;
+				*plan = cand;
+			}
+		}
+
+		if (best_err <= tolerance) {
+			found = 1U;
+			break;
+		}
+	}
+
+	if (!found) {
+		return E_PAR;
+	}
+
+	/* cache solution */
+	pthread_mutex_lock(&g_clkgen_cache_lock);
+	g_clkgen_cache[g_clkgen_cache_next] = *plan;
+	g_clkgen_cache_next = (g_clkgen_cache_next + 1U) % D_CLKGEN_CACHE_NUM;
+	if (g_clkgen_cache_num < D_CLKGEN_CACHE_NUM) {
+		g_clkgen_cache_num++;
+	}
+	pthread_mutex_unlock(&g_clkgen_cache_lock);
+
+	return E_OK;
+}
+
+/**
+ * @brief Frequency of Clock Source
+ *
+ * @param [in]	src		clock source
+ *
+ * @return frequency [Hz] (0: source is not usable)
+ */
+static double sRpiClkgenSrcFrequency(uint32_t src)
+{
+	uint8_t i;
+
+	for (i = 0; i < sizeof(g_clkgen_src) / sizeof(g_clkgen_src[0]); i++) {
+		if (g_clkgen_src[i].src == src) {
+			return (rpiRegmapGetBase() == D_BASE_BCM2711) ? g_clkgen_src[i].bcm2711 : g_clkgen_src[i].bcm2837;
+		}
+	}
+
+	return 0.0;
+}
+
+/**
+ * @brief Wait for CM_GPnCTL.BUSY
+ *
+ * Polls BUSY D_SPIN_BUSY times, then sleeps between polls
+ * (doubling from D_SLEEP_MIN_BUSY up to D_SLEEP_MAX_BUSY) until the timeout.
+ *
+ * @param [in]	ch		channel of clock manager
+ * @param [in]	busy	expected value of BUSY
+ *		@arg D_RPI_CMGPCTL_BUSY_OFF	clock generator is 'not' running
+ *		@arg D_RPI_CMGPCTL_BUSY_ON	clock generator is running
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (timeout)
+ */
+static int8_t sRpiClkgenWaitBusy(uint8_t ch, uint32_t busy)
+{
+	struct timespec ts = {0, D_SLEEP_MIN_BUSY};
+	uint64_t deadline = sRpiClkgenNow() + (uint64_t)g_clkgen_timeout * 1000ULL;
+	uint32_t spin;
+
+	for (spin = 0; rpiRegmapGetCmGpctlBusy(ch) != busy; spin++) {
+		M_INSTRUMENT_SPIN(ch);
+		if (spin < D_SPIN_BUSY) {
+			continue;
+		}
+		if (sRpiClkgenNow() >= deadline) {
+			fprintf(stderr, "timeout of CM_GP%uCTL.BUSY\n", ch);
+			return E_OBJ;
+		}
+		nanosleep(&ts, NULL);
+		if (ts.tv_nsec < D_SLEEP_MAX_BUSY) {
+			ts.tv_nsec <<= 1;
+		}
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief Write Divisor of Clock Generator
+ *
+ * @param [in]	ch		channel of clock manager
+ * @param [in]	divi	integer part of divisor
+ * @param [in]	divf	fractional part of divisor
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiClkgenWriteDiv(uint8_t ch, uint32_t divi, uint32_t divf)
+{
+	T_RPI_REGMAP_TXN txn;
+
+	/* DIVI and DIVF by one store */
+	rpiRegmapTxnBegin(&txn);
+	rpiRegmapQueueCmGpdivDivi(&txn, ch, divi);
+	rpiRegmapQueueCmGpdivDivf(&txn, ch, divf);
+	return rpiRegmapTxnCommit(&txn);
+}
+
+/**
+ * @brief Current Time
+ *
+ * @param nothing
+ *
+ * @return time of CLOCK_MONOTONIC [nsec]
+ */
+static uint64_t sRpiClkgenNow()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
@@ -0,0 +1,315 @@
+/**
+ * @file		rpi_clksched.c
+ * @brief		Clock Schedule Library Implementation
+ *
+ * Replays a schedule of divisors on a running clock generator
+ * (frequency hopping, FSK, chirp) from a dedicated thread.
+ *
+ * @author		T. Ngtk
+ * @copyright	Copyright (c) 2016 T. Ngtk
+ *
+ * @par License
+ *	Released under the MIT License.<BR>
+ *	https://github.com/ngtkt0909/raspberry-pi-gpio/blob/master/LICENSE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <assert.h>
+#include "rpi_clksched.h"
+
+/*------------------------------------------------------------------------------
+	Defined Macros
+------------------------------------------------------------------------------*/
+#define D_CLKSCHED_LEAD		(1000000)		/**< delay from start to time 0 of schedule [nsec] */
+#define D_CLKSCHED_SPIN		(50000)			/**< spin (instead of sleep) before each entry [nsec] */
+#define D_CLKSCHED_SLICE	(10000000)		/**< longest sleep between checks of stop request [nsec] */
+
+/** check stop request */
+#define M_CLKSCHED_STOP(ctx)	__atomic_load_n(&(ctx)->stop, __ATOMIC_RELAXED)
+
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief schedule item (precomputed register value) */
+typedef struct t_clksched_item {
+	uint64_t	time;		/**< time from start of schedule [nsec] */
+	uint32_t	val;		/**< value of CM_GPnDIV (password stamped) */
+} T_CLKSCHED_ITEM;
+
+/** @brief schedule context of channel */
+typedef struct t_clksched_ctx {
+	pthread_t			thread;		/**< replay thread */
+	uint8_t				running;	/**< thread is created or not */
+	uint8_t				stop;		/**< stop request */
+	uint8_t				ch;			/**< channel of clock manager */
+	T_CLKSCHED_ITEM		*items;		/**< schedule */
+	uint32_t			num;		/**< number of schedule items */
+	T_CLKSCHED_RESULT	result;		/**< result */
+} T_CLKSCHED_CTX;
+
+/*------------------------------------------------------------------------------
+	Prototype Declaration
+------------------------------------------------------------------------------*/
+static void *sRpiClkschedThread(void *arg);
+static uint64_t sRpiClkschedNow();
+
+/*------------------------------------------------------------------------------
+	Global Variables
+------------------------------------------------------------------------------*/
+static T_CLKSCHED_CTX g_clksched_ctx[D_CLKGEN_CH_NUM];				/**< schedule contexts */
+static T_RPI_REGMAP_SESSION g_clksched_session = {0U};		/**< register map session (never released) */
+
+/*------------------------------------------------------------------------------
+	Functions (External)
+------------------------------------------------------------------------------*/
+/**
+ * @brief Start Schedule
+ *
+ * Starts a thread which writes CM_GPnDIV at each time of the schedule.
+ * The thread sleeps until shortly before each entry, then spins on CLOCK_MONOTONIC.
+ * Each CM_GPnDIV write takes the register lock of rpiRegmapLockEnable(), so it
+ * does not interleave with rpiClkgenRetune() or rpiClkgenEnable() on the channel.
+ * The clock generator must be enabled (rpiClkgenEnable()), and all entries must
+ * be valid divisors of its MASH control (rpiClkgenCheckDivisor()).
+ * The schedule is copied, so entries can be released after this function.
+ *
+ * @param [in]	pin			number of GPIO pin
+ *		@arg 4, 5, 6, 20, 21, 32, 34, 42, 43, 44	GPIO pins of clock generator
+ * @param [in]	entries		schedule (time must not decrease)
+ * @param [in]	num			number of entries (1 or more)
+ * @param [in]	priority	priority of SCHED_FIFO (0: normal thread)
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (parameter error)
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiClkschedStart(uint8_t pin, const T_CLKSCHED_ENTRY *entries, uint32_t num, int32_t priority)
+{
+	T_CLKSCHED_CTX *ctx;
+	pthread_attr_t attr;
+	struct sched_param param;
+	uint32_t i;
+	uint8_t ch;
+	int ret;
+
+	/* check parameter */
+	assert(entries != NULL);
+	if ((num == 0U) || (rpiClkgenGetChannel(pin, &ch) != E_OK)) {
+		return E_PAR;
+	}
+	for (i = 0; i < num; i++) {
+		if ((i > 0) && (entries[i].time < entries[i - 1].time)) {
+			return E_PAR;
+		}
+	}
+
+	ctx = &g_clksched_ctx[ch];
+	if (ctx->running) {
+		fprintf(stderr, "schedule of GPCLK%u is running\n", ch);
+		return E_OBJ;
+	}
+
+	/* map registers */
+	if (!g_clksched_session.acquired) {
+		if (rpiRegmapAcquire(&g_clksched_session) != E_OK) {
+			return E_OBJ;
+		}
+	}
+	if (!(rpiRegmapGetBlocks() & D_RPI_BLOCK_CM) ||
+		(rpiRegmapGetCmGpctlEnab(ch) != D_RPI_CMGPCTL_ENAB_ON)) {
+		fprintf(stderr, "clock generator is not running\n");
+		return E_OBJ;
+	}
+	for (i = 0; i < num; i++) {
+		if (rpiClkgenCheckDivisor(rpiRegmapGetCmGpctlMash(ch), entries[i].divi, entries[i].divf) != E_OK) {
+			return E_PAR;
+		}
+	}
+
+	/* precompute register values */
+	if ((ctx->items = malloc(sizeof(T_CLKSCHED_ITEM) * num)) == NULL) {
+		perror("malloc");
+		return E_OBJ;
+	}
+	for (i = 0; i < num; i++) {
+		ctx->items[i].time = entries[i].time;
+		ctx->items[i].val  = M_RPI_FIELD_PASSWD(D_RPI_CMGPDIV_PASSWD) |
+							 (entries[i].divi << D_RPI_SHAMT_CMGPDIV_DIVI) |
+							 (entries[i].divf << D_RPI_SHAMT_CMGPDIV_DIVF);
+	}
+	ctx->num  = num;
+	ctx->ch   = ch;
+	ctx->stop = 0U;
+	memset(&ctx->result, 0, sizeof(ctx->result));
+
+	/* create real-time thread */
+	pthread_attr_init(&attr);
+	if (priority > 0) {
+		param.sched_priority = priority;
+		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+		pthread_attr_setschedparam(&attr, &param);
+	}
+	ret = pthread_create(&ctx->thread, &attr, sRpiClkschedThread, ctx);
+	if ((ret == EPERM) && (priority > 0)) {
+		fprintf(stderr, "SCHED_FIFO is not permitted, schedule runs as a normal thread\n");
+		pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+		ret = pthread_create(&ctx->thread, &attr, sRpiClkschedThread, ctx);
+	}
+	pthread_attr_destroy(&attr);
+	if (ret != 0) {
+		errno = ret;
+		perror("pthread_create");
+		free(ctx->items);
+		ctx->items = NULL;
+		return E_OBJ;
+	}
+
+	ctx->running = 1U;
+
+	return E_OK;
+}
+
+/**
+ * @brief Wait for End of Schedule
+ *
+ * @param [in]	pin		number of GPIO pin
+ * @param [out]	result	result of schedule (NULL: not used)
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (parameter error)
+ * @retval E_OBJ	failure (schedule is not started)
+ */
+int8_t rpiClkschedWait(uint8_t pin, T_CLKSCHED_RESULT *result)
+{
+	T_CLKSCHED_CTX *ctx;
+	uint8_t ch;
+
+	/* check parameter */
+	if (rpiClkgenGetChannel(pin, &ch) != E_OK) {
+		return E_PAR;
+	}
+
+	ctx = &g_clksched_ctx[ch];
+	if (!ctx->running) {
+		return E_OBJ;
+	}
+
+	pthread_join(ctx->thread, NULL);
+	free(ctx->items);
+	ctx->items   = NULL;
+	ctx->running = 0U;
+
+	if (result != NULL) {
+		*result = ctx->result;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief Stop Schedule
+ *
+ * The thread checks the request at least every 10 msec while sleeping and
+ * on every turn of its spin, so this returns promptly even before a distant entry.
+ * The clock generator keeps the divisor of the last written entry.
+ *
+ * @param [in]	pin		number of GPIO pin
+ * @param [out]	result	result of schedule (NULL: not used)
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (parameter error)
+ * @retval E_OBJ	failure (schedule is not started)
+ */
+int8_t rpiClkschedStop(uint8_t pin, T_CLKSCHED_RESULT *result)
+{
+	uint8_t ch;
+
+	/* check parameter */
+	if (rpiClkgenGetChannel(pin, &ch) != E_OK) {
+		return E_PAR;
+	}
+
+	__atomic_store_n(&g_clksched_ctx[ch].stop, 1U, __ATOMIC_RELAXED);
+
+	return rpiClkschedWait(pin, result);
+}
+
+/*------------------------------------------------------------------------------
+	Functions (Internal)
+------------------------------------------------------------------------------*/
+/**
+ * @brief Replay Thread of Schedule
+ *
+ * @param [in]	arg		schedule context
+ *
+ * @return NULL
+ */
+static void *sRpiClkschedThread(void *arg)
+{
+	T_CLKSCHED_CTX *ctx = (T_CLKSCHED_CTX *)arg;
+	volatile uint32_t *addr = M_RPI_ADDR_CMGPDIV(ctx->ch);
+	struct timespec ts;
+	uint64_t start, target, wake, now, late;
+	uint32_t i;
+
+	start = sRpiClkschedNow() + D_CLKSCHED_LEAD;
+
+	for (i = 0; i < ctx->num; i++) {
+		/* sleep until shortly before the entry (in slices to see stop request), then spin */
+		target = start + ctx->items[i].time;
+		while (!M_CLKSCHED_STOP(ctx) && (target > (now = sRpiClkschedNow()) + D_CLKSCHED_SPIN)) {
+			wake = target - D_CLKSCHED_SPIN;
+			if (wake > now + D_CLKSCHED_SLICE) {
+				wake = now + D_CLKSCHED_SLICE;
+			}
+			ts.tv_sec  = wake / 1000000000ULL;
+			ts.tv_nsec = wake % 1000000000ULL;
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		}
+		while (!M_CLKSCHED_STOP(ctx) && (sRpiClkschedNow() < target));
+		if (M_CLKSCHED_STOP(ctx)) {
+			break;
+		}
+
+		/* write divisor */
+		rpiRegmapLock(M_RPI_SLOT_CMGPDIV(ctx->ch));
+		rpiRegmapRawWrite(addr, ctx->items[i].val);
+		rpiRegmapShadowStore(M_RPI_SLOT_CMGPDIV(ctx->ch), ctx->items[i].val & ~D_RPI_MASK_CMGPDIV_PASSWD);
+		rpiRegmapUnlock(M_RPI_SLOT_CMGPDIV(ctx->ch));
+		now = sRpiClkschedNow();
+
+		/* lateness */
+		late = now - target;
+		ctx->result.sum_late += late;
+		if (late > ctx->result.max_late) {
+			ctx->result.max_late     = late;
+			ctx->result.max_late_idx = i;
+		}
+		ctx->result.num++;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Current Time
+ *
+ * @param nothing
+ *
+ * @return time of CLOCK_MONOTONIC [nsec]
+ */
+static uint64_t sRpiClkschedNow()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
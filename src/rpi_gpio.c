@@ -12,33 +12,141 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
 #include <stdio.h>
-#include <stdlib.h>
+#include <string.h>
 #include <math.h>
-#include <limits.h>
 #include <assert.h>
+#include <linux/gpio.h>
 #include "rpi_gpio.h"
+#include "rpi_instrument.h"
 
 /*------------------------------------------------------------------------------
 	Defined Macros
 ------------------------------------------------------------------------------*/
+#ifndef D_DIR_GPIO
 #define D_DIR_GPIO			"/sys/class/gpio/"		/**< GPIO file */
+#endif
+#ifndef D_DEV_GPIOCHIP
+#define D_DEV_GPIOCHIP		"/dev/gpiochip0"		/**< GPIO character device */
+#endif
+#ifndef D_GPIO_EVENT_CLOCK
+#define D_GPIO_EVENT_CLOCK	(0)						/**< event clock flag (0: CLOCK_MONOTONIC) */
+#endif
+#define D_GPIO_CONSUMER		"rpi-gpio"				/**< consumer label of line requests */
+#define D_GPIO_PIN_NUM		(54)					/**< number of GPIO pins */
+#define D_PIN_INVALID		(0xFF)					/**< invalid number of GPIO pin */
+#define D_FD_NOT_OPENED		(-1)					/**< file descriptor (not opened) */
+#define D_GPIO_EVENT_BUF	(16)					/**< number of line events read at once */
+#define D_GPIO_EPOLL_CDEV	(1ULL << 32)			/**< epoll data tag of line requests */
 #define D_LENGTH_PIN		(3)						/**< maximum string length for pin */
 #define D_LENGTH_PATH		(256)					/**< maximum string length for path */
 #define D_LENGTH_VAL		(1)						/**< maximum string length for value */
-#define D_DELAY_FILEGEN		(100000)				/**< delay time between declaration of pin and dir */
+#define D_TIMEOUT_FILEGEN	(1000000)				/**< default timeout for gpio file generation (usec) */
+#define D_POLL_MIN_FILEGEN	(500)					/**< first polling interval for gpio file generation (usec) */
+#define D_POLL_MAX_FILEGEN	(10000)					/**< last polling interval for gpio file generation (usec) */
 
 /** calc digit size */
 #define M_DIGIT_SIZE(val)	((uint32_t)log10((double)(val)) + 1)
 
+/** check number of GPIO pin */
+#define M_CHECK_PIN(pin)	((pin >= 0) && (pin < D_GPIO_PIN_NUM))
+
+/** check direction of GPIO pin */
+#define M_CHECK_DIR(dir)	((dir == D_GPIO_DIR_IN) || (dir == D_GPIO_DIR_OUT))
+
+/** check edge of GPIO pin */
+#define M_CHECK_EDGE(edge)	((edge >= D_GPIO_EDGE_NONE) && (edge <= D_GPIO_EDGE_BOTH))
+
+/** check backend */
+#define M_CHECK_BACKEND(backend) \
+	((backend == D_GPIO_BACKEND_SYSFS) || (backend == D_GPIO_BACKEND_CDEV))
+
+/** check whether GPIO pin is opened via character device */
+#define M_IS_CDEV(pin) \
+	((g_gpio_port[pin].fd != D_FD_NOT_OPENED) && (g_gpio_port[pin].backend == D_GPIO_BACKEND_CDEV))
+
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief GPIO attribute string table */
+typedef struct t_gpio_attr_info {
+	char	*str;		/**< string of attribute */
+	uint8_t	size;		/**< byte-size of string attribute */
+	int		flags;		/**< access mode of "value" file (direction only) */
+} T_GPIO_ATTR_INFO;
+
+/** @brief GPIO pin state */
+typedef struct t_gpio_port {
+	int		fd;			/**< "value" file (sysfs) or line request (character device) */
+	uint8_t	backend;	/**< backend which opened the pin */
+	uint8_t	line;		/**< index of line in the line request (character device) */
+	uint8_t	dir;		/**< direction */
+	uint8_t	edge;		/**< edge to be detected */
+	uint8_t	event;		/**< registered to rpiGpioEventWait() or not */
+	int		held;		/**< line request still holding the closed pin (character device) */
+} T_GPIO_PORT;
+
 /*------------------------------------------------------------------------------
 	Prototype Declaration
 ------------------------------------------------------------------------------*/
-static int8_t sRpiGpioOpen(uint8_t pin, char *dir, uint8_t dir_size);
+static int8_t sRpiGpioOpen(uint8_t pin, uint8_t dir);
+static int8_t sRpiGpioExport(uint8_t pin);
+static int8_t sRpiGpioWaitReady(uint8_t pin, const struct timespec *deadline);
+static int8_t sRpiGpioSetup(uint8_t pin, uint8_t dir);
+static void sRpiGpioGetDeadline(struct timespec *deadline);
+static int8_t sRpiGpioSetValue(uint8_t pin, char *val_str);
+static int8_t sRpiGpioParseValue(char val_char, int32_t *val);
 static int8_t sRpiGpioWrite(char *path, char *str, uint8_t str_size);
 static int8_t sRpiGpioRead(char *path, char *str, uint8_t str_size);
+static int8_t sRpiGpioCdevRequest(const uint8_t *pins, const uint8_t *dirs, size_t num);
+static int8_t sRpiGpioCdevReuse(uint8_t pin, uint8_t dir);
+static int8_t sRpiGpioCdevRelease(uint8_t pin);
+static int8_t sRpiGpioCdevConfig(int fd);
+static void sRpiGpioCdevBuildConfig(const uint8_t *pins, size_t num, struct gpio_v2_line_config *config);
+static int8_t sRpiGpioCdevSetValue(uint8_t pin, int32_t val);
+static int8_t sRpiGpioCdevGetValue(uint8_t pin, int32_t *val);
+static int8_t sRpiGpioCdevReadEvents(int fd, T_GPIO_EVENT *events, uint32_t max, uint32_t *num, uint8_t all);
+
+/*------------------------------------------------------------------------------
+	Global Variables
+------------------------------------------------------------------------------*/
+/** state of GPIO pins (index: number of GPIO pin) */
+static T_GPIO_PORT g_gpio_port[D_GPIO_PIN_NUM] = {
+	[0 ... D_GPIO_PIN_NUM - 1] = {D_FD_NOT_OPENED, D_GPIO_BACKEND_SYSFS, 0U,
+								  D_GPIO_DIR_IN, D_GPIO_EDGE_NONE, 0U, D_FD_NOT_OPENED}
+};
+
+/** backend used by following open requests */
+static uint8_t g_gpio_backend = D_GPIO_BACKEND_SYSFS;
+
+/** path of GPIO character device */
+static char g_gpio_chip[D_LENGTH_PATH] = D_DEV_GPIOCHIP;
+
+/** timeout for gpio file generation (usec) */
+static uint32_t g_gpio_timeout = D_TIMEOUT_FILEGEN;
+
+/** map table: direction of GPIO pin -> string of direction */
+static const T_GPIO_ATTR_INFO g_gpio_dir_info[] = {
+	{"in",	2U,	O_RDONLY},		/* D_GPIO_DIR_IN */
+	{"out",	3U,	O_RDWR},		/* D_GPIO_DIR_OUT */
+};
+
+/** map table: edge of GPIO pin -> string of edge */
+static const T_GPIO_ATTR_INFO g_gpio_edge_info[] = {
+	{"none",	4U,	0},			/* D_GPIO_EDGE_NONE */
+	{"rising",	6U,	0},			/* D_GPIO_EDGE_RISING */
+	{"falling",	7U,	0},			/* D_GPIO_EDGE_FALLING */
+	{"both",	4U,	0},			/* D_GPIO_EDGE_BOTH */
+};
+
+/** epoll instance for rpiGpioEventWait() */
+static int g_gpio_epfd = D_FD_NOT_OPENED;
 
 /*------------------------------------------------------------------------------
 	Functions (External)
@@ -53,8 +161,10 @@ static int8_t sRpiGpioRead(char *path, char *str, uint8_t str_size);
  */
 int8_t rpiGpioOpenIn(uint8_t pin)
 {
+	M_INSTRUMENT_FUNC(GPIO_OPEN_IN);
+
 	/* declare GPIO pin as input direction */
-	return sRpiGpioOpen(pin, "in", 2U);
+	return sRpiGpioOpen(pin, D_GPIO_DIR_IN);
 }
 
 /**
@@ -67,13 +177,19 @@ int8_t rpiGpioOpenIn(uint8_t pin)
  */
 int8_t rpiGpioOpenOut(uint8_t pin)
 {
+	M_INSTRUMENT_FUNC(GPIO_OPEN_OUT);
+
 	/* declare GPIO pin as output direction */
-	return sRpiGpioOpen(pin, "out", 3U);
+	return sRpiGpioOpen(pin, D_GPIO_DIR_OUT);
 }
 
 /**
  * @brief GPIO Port Close
  *
+ * With the character device, a pin requested together with other pins
+ * (rpiGpioOpenMany()) is reconfigured as an input and stays in the line request
+ * until all of them are closed. Opening it again reuses the line request.
+ *
  * @param [in]	pin	number of GPIO pin
  *
  * @retval E_OK		success
@@ -82,14 +198,184 @@ int8_t rpiGpioOpenOut(uint8_t pin)
 int8_t rpiGpioClose(uint8_t pin)
 {
 	char pin_str[D_LENGTH_PIN];
+	int8_t ret = E_OK;
+
+	M_INSTRUMENT_FUNC(GPIO_CLOSE);
 
 	/* check parameter */
+	assert(M_CHECK_PIN(pin));
 	assert(sizeof("") + M_DIGIT_SIZE(pin) <= D_LENGTH_PIN);
 
+	/* release line of character device */
+	if (M_IS_CDEV(pin)) {
+		return sRpiGpioCdevRelease(pin);
+	}
+
+	/* closed pin still held by a line request (not exported) */
+	if (g_gpio_port[pin].held != D_FD_NOT_OPENED) {
+		fprintf(stderr, "GPIO pin %d is not opened\n", pin);
+		return E_OBJ;
+	}
+
+	/* close "value" file */
+	if (g_gpio_port[pin].fd != D_FD_NOT_OPENED) {
+		if (close(g_gpio_port[pin].fd) == -1) {
+			perror("close");
+			ret = E_OBJ;
+		}
+		g_gpio_port[pin].fd    = D_FD_NOT_OPENED;
+		g_gpio_port[pin].event = 0U;
+	}
+
 	/* undeclare GPIO pin */
 	sprintf(pin_str, "%d", pin);
+	if (sRpiGpioWrite(D_DIR_GPIO "unexport", pin_str, M_DIGIT_SIZE(pin)) != E_OK) {
+		ret = E_OBJ;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief GPIO Ports Open (Multiple Pins)
+ *
+ * sysfs backend: all pins are exported first, then the generation of gpio
+ * files is waited for once, and finally the directions are declared.<BR>
+ * character device backend: all pins are requested by a single line request.
+ * If it fails, each pin is requested separately to find out the failed ones.
+ *
+ * @param [in]	pins	array of GPIO pin numbers
+ * @param [in]	dirs	array of directions
+ *		@arg D_GPIO_DIR_IN		input direction
+ *		@arg D_GPIO_DIR_OUT		output direction
+ * @param [in]	n		number of elements
+ * @param [out]	results	array of results for each pin (E_OK, E_PAR or E_OBJ)
+ *
+ * @retval E_OK		success (all pins)
+ * @retval E_OBJ	failure (one or more pins, refer to results)
+ */
+int8_t rpiGpioOpenMany(const uint8_t *pins, const uint8_t *dirs, size_t n, int8_t *results)
+{
+	struct timespec deadline;
+	uint8_t req_pins[D_GPIO_PIN_NUM], req_dirs[D_GPIO_PIN_NUM];
+	uint64_t req_mask = 0ULL;
+	size_t req_num = 0;
+	int8_t ret = E_OK;
+	size_t i, j;
+
+	M_INSTRUMENT_FUNC(GPIO_OPEN_MANY);
+
+	/* check parameter */
+	assert(pins != NULL);
+	assert(dirs != NULL);
+	assert(results != NULL);
+
+	/* request all lines of character device at once */
+	if (g_gpio_backend == D_GPIO_BACKEND_CDEV) {
+		for (i = 0; i < n; i++) {
+			if (!M_CHECK_PIN(pins[i]) || !M_CHECK_DIR(dirs[i])) {
+				results[i] = E_PAR;
+			} else if ((g_gpio_port[pins[i]].fd != D_FD_NOT_OPENED) ||
+					   ((req_mask >> pins[i]) & 1ULL)) {
+				results[i] = E_OBJ;
+			} else if (g_gpio_port[pins[i]].held != D_FD_NOT_OPENED) {
+				/* line is still held by a previous request */
+				results[i] = sRpiGpioCdevReuse(pins[i], dirs[i]);
+			} else {
+				results[i] = E_OK;
+				req_mask |= 1ULL << pins[i];
+				req_pins[req_num] = pins[i];
+				req_dirs[req_num] = dirs[i];
+				req_num++;
+			}
+		}
+
+		if ((req_num > 0) && (sRpiGpioCdevRequest(req_pins, req_dirs, req_num) != E_OK)) {
+			/* queued pins only (reused pins are not in the request) */
+			for (i = 0, j = 0; i < n; i++) {
+				if ((results[i] == E_OK) && ((req_mask >> pins[i]) & 1ULL)) {
+					results[i] = sRpiGpioCdevRequest(&req_pins[j], &req_dirs[j], 1);
+					j++;
+				}
+			}
+		}
+
+		for (i = 0; i < n; i++) {
+			if (results[i] != E_OK) {
+				ret = E_OBJ;
+			}
+		}
+
+		return ret;
+	}
+
+	/* declare GPIO pins */
+	for (i = 0; i < n; i++) {
+		if (!M_CHECK_PIN(pins[i]) || !M_CHECK_DIR(dirs[i])) {
+			results[i] = E_PAR;
+		} else if ((g_gpio_port[pins[i]].fd != D_FD_NOT_OPENED) ||
+				   (g_gpio_port[pins[i]].held != D_FD_NOT_OPENED)) {
+			results[i] = E_OBJ;
+		} else {
+			results[i] = sRpiGpioExport(pins[i]);
+		}
+	}
+
+	/* wait for gpio file generation */
+	sRpiGpioGetDeadline(&deadline);
+	for (i = 0; i < n; i++) {
+		if (results[i] == E_OK) {
+			results[i] = sRpiGpioWaitReady(pins[i], &deadline);
+		}
+	}
+
+	/* declare GPIO directions */
+	for (i = 0; i < n; i++) {
+		if (results[i] == E_OK) {
+			results[i] = sRpiGpioSetup(pins[i], dirs[i]);
+		}
+		if (results[i] != E_OK) {
+			ret = E_OBJ;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief GPIO Ports Close (Multiple Pins)
+ *
+ * @param [in]	pins	array of GPIO pin numbers
+ * @param [in]	n		number of elements
+ * @param [out]	results	array of results for each pin (E_OK, E_PAR or E_OBJ)
+ *
+ * @retval E_OK		success (all pins)
+ * @retval E_OBJ	failure (one or more pins, refer to results)
+ */
+int8_t rpiGpioCloseMany(const uint8_t *pins, size_t n, int8_t *results)
+{
+	int8_t ret = E_OK;
+	size_t i;
 
-	return sRpiGpioWrite(D_DIR_GPIO "unexport", pin_str, M_DIGIT_SIZE(pin));
+	M_INSTRUMENT_FUNC(GPIO_CLOSE_MANY);
+
+	/* check parameter */
+	assert(pins != NULL);
+	assert(results != NULL);
+
+	/* undeclare GPIO pins */
+	for (i = 0; i < n; i++) {
+		if (!M_CHECK_PIN(pins[i])) {
+			results[i] = E_PAR;
+		} else {
+			results[i] = rpiGpioClose(pins[i]);
+		}
+		if (results[i] != E_OK) {
+			ret = E_OBJ;
+		}
+	}
+
+	return ret;
 }
 
 /**
@@ -102,15 +388,10 @@ int8_t rpiGpioClose(uint8_t pin)
  */
 int8_t rpiGpioSet(uint8_t pin)
 {
-	char pin_str[D_LENGTH_PATH];
-
-	/* check parameter */
-	assert(sizeof(D_DIR_GPIO "gpio/value") + M_DIGIT_SIZE(pin) <= D_LENGTH_PATH);
+	M_INSTRUMENT_FUNC(GPIO_SET);
 
 	/* set GPIO pin */
-	sprintf(pin_str, D_DIR_GPIO "gpio%d/value", pin);
-
-	return sRpiGpioWrite(pin_str, "1", 1U);
+	return sRpiGpioSetValue(pin, "1");
 }
 
 /**
@@ -123,21 +404,17 @@ int8_t rpiGpioSet(uint8_t pin)
  */
 int8_t rpiGpioClr(uint8_t pin)
 {
-	char path_str[D_LENGTH_PATH];
-
-	/* check parameter */
-	assert(sizeof(D_DIR_GPIO "gpio/value") + M_DIGIT_SIZE(pin) <= D_LENGTH_PATH);
+	M_INSTRUMENT_FUNC(GPIO_CLR);
 
 	/* clear GPIO pin */
-	sprintf(path_str, D_DIR_GPIO "gpio%d/value", pin);
-
-	return sRpiGpioWrite(path_str, "0", 1U);
+	return sRpiGpioSetValue(pin, "0");
 }
 
 /**
  * @brief GPIO Port Get
  *
  * @param [in]	pin	number of GPIO pin
+ * @param [out]	val	address of pin level (0 or 1)
  *
  * @retval E_OK		success
  * @retval E_OBJ	failure (object error)
@@ -148,95 +425,155 @@ int8_t rpiGpioGet(uint8_t pin, int32_t *val)
 	char val_str[D_LENGTH_VAL];
 	int8_t ret;
 
-	/* read GPIO pin */
-	sprintf(path_str, D_DIR_GPIO "gpio%d/value", pin);
+	M_INSTRUMENT_FUNC(GPIO_GET);
 
-	ret = sRpiGpioRead(path_str, val_str, D_LENGTH_VAL);
-	assert(ret == E_OK);
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(val != NULL);
 
-	/* convert string to integer */
-	*val = strtol(val_str, NULL, 0);
-	if ((*val == LONG_MIN) || (*val == LONG_MAX)) {
-		perror("strtol");
-		return E_OBJ;
+	if (M_IS_CDEV(pin)) {
+		/* read GPIO pin through the line request */
+		return sRpiGpioCdevGetValue(pin, val);
+	} else if (g_gpio_port[pin].fd != D_FD_NOT_OPENED) {
+		/* read GPIO pin through the opened "value" file */
+		if (pread(g_gpio_port[pin].fd, val_str, D_LENGTH_VAL, 0) != D_LENGTH_VAL) {
+			perror("pread");
+			return E_OBJ;
+		}
+	} else {
+		/* read GPIO pin exported by others */
+		sprintf(path_str, D_DIR_GPIO "gpio%d/value", pin);
+		if ((ret = sRpiGpioRead(path_str, val_str, D_LENGTH_VAL)) != E_OK) {
+			return ret;
+		}
 	}
 
-	return E_OK;
+	/* convert character to integer */
+	return sRpiGpioParseValue(val_str[0], val);
 }
 
-/*------------------------------------------------------------------------------
-	Functions (Internal)
-------------------------------------------------------------------------------*/
 /**
- * @brief GPIO Port Open
+ * @brief GPIO Ports Write (Multiple Pins)
  *
- * @param [in]	pin			number of GPIO pin
- * @param [in]	dir			string of direction
- *		@args "in"	input direction
- *		@args "out"	output direction
- * @param [in]	dir_size	byte-size of string direction
+ * Pins belonging to the same line request of the character device are
+ * written by a single ioctl.
+ *
+ * @param [in]	pins	array of GPIO pin numbers
+ * @param [in]	vals	array of pin levels (0 or 1)
+ * @param [in]	n		number of elements
  *
  * @retval E_OK		success
  * @retval E_OBJ	failure (object error)
  */
-static int8_t sRpiGpioOpen(uint8_t pin, char *dir, uint8_t dir_size)
+int8_t rpiGpioWriteMany(const uint8_t *pins, const uint8_t *vals, size_t n)
 {
-	char pin_str[D_LENGTH_PIN];
-	char path_str[D_LENGTH_PATH];
-	int8_t ret;
+	struct gpio_v2_line_values lv;
+	uint64_t done = 0ULL;
+	int8_t ret = E_OK;
+	size_t i, j;
+	int fd;
+
+	M_INSTRUMENT_FUNC(GPIO_WRITE_MANY);
 
 	/* check parameter */
-	assert(sizeof("") + M_DIGIT_SIZE(pin) <= D_LENGTH_PIN);
-	assert(sizeof(D_DIR_GPIO "gpio/direction") + M_DIGIT_SIZE(pin) <= D_LENGTH_PATH);
+	assert(pins != NULL);
+	assert(vals != NULL);
 
-	/* declare GPIO pin */
-	sprintf(pin_str, "%d", pin);
-	if ((ret = sRpiGpioWrite(D_DIR_GPIO "export", pin_str, M_DIGIT_SIZE(pin))) != E_OK) {
-		return ret;
-	}
+	for (i = 0; i < n; i++) {
+		assert(M_CHECK_PIN(pins[i]));
 
-	/* wait for gpio file generation */
-	usleep(D_DELAY_FILEGEN);
+		/* write GPIO pin of sysfs */
+		if (!M_IS_CDEV(pins[i])) {
+			if (sRpiGpioSetValue(pins[i], vals[i] ? "1" : "0") != E_OK) {
+				ret = E_OBJ;
+			}
+			continue;
+		}
 
-	/* declare GPIO direction */
-	sprintf(path_str, D_DIR_GPIO "gpio%d/direction", pin);
-	if ((ret = sRpiGpioWrite(path_str, dir, dir_size)) != E_OK) {
-		return ret;
+		/* write all GPIO pins sharing the line request */
+		if ((done >> pins[i]) & 1ULL) {
+			continue;
+		}
+		fd = g_gpio_port[pins[i]].fd;
+		lv.bits = 0ULL;
+		lv.mask = 0ULL;
+		for (j = i; j < n; j++) {
+			if (M_CHECK_PIN(pins[j]) && M_IS_CDEV(pins[j]) && (g_gpio_port[pins[j]].fd == fd)) {
+				lv.mask |=  1ULL << g_gpio_port[pins[j]].line;
+				lv.bits &= ~(1ULL << g_gpio_port[pins[j]].line);
+				lv.bits |= (vals[j] ? 1ULL : 0ULL) << g_gpio_port[pins[j]].line;
+				done    |= 1ULL << pins[j];
+			}
+		}
+		if (ioctl(fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv) == -1) {
+			perror("ioctl");
+			ret = E_OBJ;
+		}
 	}
 
-	return E_OK;
+	return ret;
 }
 
 /**
- * @brief Write to File
+ * @brief GPIO Ports Read (Multiple Pins)
  *
- * @param [in]	path		file path
- * @param [in]	str			string to be wrote
- * @param [in]	str_size	byte-size of string to be wrote
+ * Pins belonging to the same line request of the character device are
+ * read by a single ioctl.
+ *
+ * @param [in]	pins	array of GPIO pin numbers
+ * @param [out]	vals	array of pin levels (0 or 1)
+ * @param [in]	n		number of elements
  *
  * @retval E_OK		success
  * @retval E_OBJ	failure (object error)
  */
-static int8_t sRpiGpioWrite(char *path, char *str, uint8_t str_size)
+int8_t rpiGpioReadMany(const uint8_t *pins, int32_t *vals, size_t n)
 {
-	int fd;
+	struct gpio_v2_line_values lv;
+	uint64_t done = 0ULL;
 	int8_t ret = E_OK;
+	size_t i, j;
+	int fd;
 
-	/* open file path */
-	if ((fd = open(path, O_WRONLY)) == -1) {
-		perror("open");
-		ret = E_OBJ;
-	} else {
-		/* write to the file */
-		if (write(fd, str, str_size) != str_size) {
-			perror("write");
-			ret = E_OBJ;
+	M_INSTRUMENT_FUNC(GPIO_READ_MANY);
+
+	/* check parameter */
+	assert(pins != NULL);
+	assert(vals != NULL);
+
+	for (i = 0; i < n; i++) {
+		assert(M_CHECK_PIN(pins[i]));
+
+		/* read GPIO pin of sysfs */
+		if (!M_IS_CDEV(pins[i])) {
+			if (rpiGpioGet(pins[i], &vals[i]) != E_OK) {
+				ret = E_OBJ;
+			}
+			continue;
 		}
 
-		/* close file path */
-		if (close(fd) == -1) {
-			perror("close");
+		/* read all GPIO pins sharing the line request */
+		if ((done >> pins[i]) & 1ULL) {
+			continue;
+		}
+		fd = g_gpio_port[pins[i]].fd;
+		lv.bits = 0ULL;
+		lv.mask = 0ULL;
+		for (j = i; j < n; j++) {
+			if (M_CHECK_PIN(pins[j]) && M_IS_CDEV(pins[j]) && (g_gpio_port[pins[j]].fd == fd)) {
+				lv.mask |= 1ULL << g_gpio_port[pins[j]].line;
+			}
+		}
+		if (ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv) == -1) {
+			perror("ioctl");
 			ret = E_OBJ;
+			continue;
+		}
+		for (j = i; j < n; j++) {
+			if (M_CHECK_PIN(pins[j]) && M_IS_CDEV(pins[j]) && (g_gpio_port[pins[j]].fd == fd)) {
+				vals[j] = (int32_t)((lv.bits >> g_gpio_port[pins[j]].line) & 1ULL);
+				done   |= 1ULL << pins[j];
+			}
 		}
 	}
 
@@ -244,37 +581,1063 @@ static int8_t sRpiGpioWrite(char *path, char *str, uint8_t str_size)
 }
 
 /**
- * @brief Read from File
+ * @brief GPIO Backend Setting
  *
- * @param [in]	path		file path
- * @param [in]	str			string to be wrote
- * @param [in]	str_size	byte-size of string to be read
+ * Selects the kernel interface used by following open requests.
+ * Pins which are already opened keep their backend until closed.
+ *
+ * @param [in]	backend	backend
+ *		@arg D_GPIO_BACKEND_SYSFS	sysfs (/sys/class/gpio)
+ *		@arg D_GPIO_BACKEND_CDEV	GPIO character device (/dev/gpiochipN)
+ *
+ * @retval E_OK		success
+ */
+int8_t rpiGpioSetBackend(uint8_t backend)
+{
+	/* check parameter */
+	assert(M_CHECK_BACKEND(backend));
+
+	g_gpio_backend = backend;
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Character Device Setting
+ *
+ * @param [in]	chip_path	string of path for GPIO character device (e.g. "/dev/gpiochip0")
+ *
+ * @retval E_OK		success
+ */
+int8_t rpiGpioSetChip(const char *chip_path)
+{
+	/* check parameter */
+	assert(chip_path != NULL);
+	assert(strlen(chip_path) < D_LENGTH_PATH);
+
+	strcpy(g_gpio_chip, chip_path);
+	return E_OK;
+}
+
+/**
+ * @brief GPIO File Generation Timeout Setting
+ *
+ * Opening a pin waits until the kernel (and udev) have made "gpioN/direction"
+ * writable, but no longer than this timeout.
+ *
+ * @param [in]	timeout	timeout (usec)
+ *
+ * @retval E_OK		success
+ */
+int8_t rpiGpioSetTimeout(uint32_t timeout)
+{
+	g_gpio_timeout = timeout;
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Port Edge Setting
+ *
+ * Selects the edges which make the "value" file of an input pin
+ * report POLLPRI (sysfs), or the line request report POLLIN (character device).
+ *
+ * @param [in]	pin		number of GPIO pin
+ * @param [in]	edge	edge to be detected
+ *		@arg D_GPIO_EDGE_NONE		no edge (interrupt disabled)
+ *		@arg D_GPIO_EDGE_RISING		rising edge
+ *		@arg D_GPIO_EDGE_FALLING	falling edge
+ *		@arg D_GPIO_EDGE_BOTH		both edges
  *
  * @retval E_OK		success
  * @retval E_OBJ	failure (object error)
  */
-static int8_t sRpiGpioRead(char *path, char *str, uint8_t str_size)
+int8_t rpiGpioSetEdge(uint8_t pin, uint8_t edge)
 {
-	int fd;
-	int8_t ret = E_OK;
+	char path_str[D_LENGTH_PATH];
+	uint8_t prev;
 
-	/* open file path */
-	if ((fd = open(path, O_RDONLY)) == -1) {
-		perror("open");
-		ret = E_OBJ;
-	} else {
-		/* read from the file */
-		if (read(fd, str, str_size) != str_size) {
-			perror("read");
-			ret = E_OBJ;
-		}
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(M_CHECK_EDGE(edge));
+	assert(sizeof(D_DIR_GPIO "gpio/edge") + M_DIGIT_SIZE(pin) <= D_LENGTH_PATH);
 
-		/* close file path */
-		if (close(fd) == -1) {
-			perror("close");
-			ret = E_OBJ;
+	/* reconfigure line request */
+	if (M_IS_CDEV(pin)) {
+		prev = g_gpio_port[pin].edge;
+		g_gpio_port[pin].edge = edge;
+		if (sRpiGpioCdevConfig(g_gpio_port[pin].fd) != E_OK) {
+			g_gpio_port[pin].edge = prev;
+			return E_OBJ;
 		}
+		return E_OK;
 	}
 
-	return ret;
+	/* declare GPIO edge */
+	sprintf(path_str, D_DIR_GPIO "gpio%d/edge", pin);
+
+	if (sRpiGpioWrite(path_str, g_gpio_edge_info[edge].str, g_gpio_edge_info[edge].size) != E_OK) {
+		return E_OBJ;
+	}
+
+	g_gpio_port[pin].edge = edge;
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Port File Descriptor Getter
+ *
+ * The returned descriptor can be registered to the caller's own event loop
+ * with POLLPRI | POLLERR (sysfs) or POLLIN (character device).
+ * When it becomes ready, call rpiGpioReadEvent() to acknowledge the event.
+ * The descriptor is owned by the library and closed by rpiGpioClose().
+ * With the character device, pins opened by one rpiGpioOpenMany() share
+ * the same descriptor.
+ *
+ * @param [in]	pin	number of GPIO pin
+ * @param [out]	fd	address of file descriptor
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiGpioGetFd(uint8_t pin, int *fd)
+{
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(fd != NULL);
+
+	/* check port */
+	if (g_gpio_port[pin].fd == D_FD_NOT_OPENED) {
+		fprintf(stderr, "GPIO pin %d is not opened\n", pin);
+		return E_OBJ;
+	}
+
+	*fd = g_gpio_port[pin].fd;
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Port Event Read
+ *
+ * sysfs: reads the pin level from the beginning of the "value" file, which
+ * also re-arms POLLPRI for the next edge.<BR>
+ * character device: reads one kernel event from the line request.
+ * event->pin may differ from pin when the request is shared by several pins.
+ *
+ * @param [in]	pin		number of GPIO pin
+ * @param [out]	event	address of event
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiGpioReadEvent(uint8_t pin, T_GPIO_EVENT *event)
+{
+	struct timespec now;
+	uint32_t num;
+
+	M_INSTRUMENT_FUNC(GPIO_READ_EVENT);
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(event != NULL);
+
+	/* read kernel event */
+	if (M_IS_CDEV(pin)) {
+		if (sRpiGpioCdevReadEvents(g_gpio_port[pin].fd, event, 1U, &num, 1U) != E_OK) {
+			return E_OBJ;
+		}
+		if (num == 0) {
+			fprintf(stderr, "no event on GPIO pin %d\n", pin);
+			return E_OBJ;
+		}
+		return E_OK;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	event->pin       = pin;
+	event->timestamp = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+
+	return rpiGpioGet(pin, &event->level);
+}
+
+/**
+ * @brief GPIO Port Event Registration
+ *
+ * Adds an opened pin to the epoll instance waited by rpiGpioEventWait().
+ * The pin is removed automatically by rpiGpioClose().
+ *
+ * @param [in]	pin	number of GPIO pin
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiGpioEventAdd(uint8_t pin)
+{
+	struct epoll_event ev;
+	int32_t val;
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+
+	/* check port */
+	if (g_gpio_port[pin].fd == D_FD_NOT_OPENED) {
+		fprintf(stderr, "GPIO pin %d is not opened\n", pin);
+		return E_OBJ;
+	}
+
+	/* create epoll instance at the first registration */
+	if (g_gpio_epfd == D_FD_NOT_OPENED) {
+		if ((g_gpio_epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+			perror("epoll_create1");
+			g_gpio_epfd = D_FD_NOT_OPENED;
+			return E_OBJ;
+		}
+	}
+
+	if (M_IS_CDEV(pin)) {
+		/* register line request (it may be already registered by other pins) */
+		ev.events   = EPOLLIN;
+		ev.data.u64 = D_GPIO_EPOLL_CDEV | (uint32_t)g_gpio_port[pin].fd;
+		if ((epoll_ctl(g_gpio_epfd, EPOLL_CTL_ADD, g_gpio_port[pin].fd, &ev) == -1) &&
+			(errno != EEXIST)) {
+			perror("epoll_ctl");
+			return E_OBJ;
+		}
+	} else {
+		/* consume pending event */
+		if (rpiGpioGet(pin, &val) != E_OK) {
+			return E_OBJ;
+		}
+
+		/* register "value" file */
+		ev.events   = EPOLLPRI | EPOLLERR;
+		ev.data.u64 = pin;
+		if (epoll_ctl(g_gpio_epfd, EPOLL_CTL_ADD, g_gpio_port[pin].fd, &ev) == -1) {
+			perror("epoll_ctl");
+			return E_OBJ;
+		}
+	}
+
+	g_gpio_port[pin].event = 1U;
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Port Event Unregistration
+ *
+ * @param [in]	pin	number of GPIO pin
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiGpioEventDel(uint8_t pin)
+{
+	uint8_t i;
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+
+	/* check port */
+	if ((g_gpio_port[pin].fd == D_FD_NOT_OPENED) || (g_gpio_epfd == D_FD_NOT_OPENED)) {
+		fprintf(stderr, "GPIO pin %d is not registered\n", pin);
+		return E_OBJ;
+	}
+
+	g_gpio_port[pin].event = 0U;
+
+	/* keep line request registered while other pins sharing it are registered */
+	if (M_IS_CDEV(pin)) {
+		for (i = 0; i < D_GPIO_PIN_NUM; i++) {
+			if (M_IS_CDEV(i) && (g_gpio_port[i].fd == g_gpio_port[pin].fd) &&
+				g_gpio_port[i].event) {
+				return E_OK;
+			}
+		}
+	}
+
+	/* unregister "value" file or line request */
+	if (epoll_ctl(g_gpio_epfd, EPOLL_CTL_DEL, g_gpio_port[pin].fd, NULL) == -1) {
+		perror("epoll_ctl");
+		return E_OBJ;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Port Event Waiting
+ *
+ * Waits for edges on all pins registered by rpiGpioEventAdd() and returns
+ * them as a batch.<BR>
+ * sysfs: pins which changed more than once since the previous call are
+ * reported once with their current level and the wake-up time.<BR>
+ * character device: every edge is reported with its kernel timestamp.
+ *
+ * @param [out]	events	array of events
+ * @param [in]	max		number of elements of events
+ * @param [in]	timeout	timeout (msec, -1: infinite)
+ * @param [out]	num		address of number of stored events
+ *
+ * @retval E_OK		success (including timeout and signal interruption, *num = 0)
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiGpioEventWait(T_GPIO_EVENT *events, uint32_t max, int32_t timeout, uint32_t *num)
+{
+	struct epoll_event ev[D_GPIO_PIN_NUM];
+	struct timespec now;
+	uint64_t timestamp;
+	uint32_t cdev_num;
+	uint8_t pin;
+	int ev_num, i;
+
+	M_INSTRUMENT_FUNC(GPIO_EVENT_WAIT);
+
+	/* check parameter */
+	assert(events != NULL);
+	assert(num != NULL);
+	assert(max > 0);
+
+	*num = 0;
+
+	/* check epoll instance */
+	if (g_gpio_epfd == D_FD_NOT_OPENED) {
+		fprintf(stderr, "no GPIO pin is registered\n");
+		return E_OBJ;
+	}
+
+	/* wait for events */
+	if ((ev_num = epoll_wait(g_gpio_epfd, ev, (max < D_GPIO_PIN_NUM) ? (int)max : D_GPIO_PIN_NUM,
+							 timeout)) == -1) {
+		if (errno == EINTR) {
+			return E_OK;
+		}
+		perror("epoll_wait");
+		return E_OBJ;
+	}
+
+	/* read levels (all events of a batch share the wake-up time) */
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timestamp = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+	for (i = 0; (i < ev_num) && (*num < max); i++) {
+		/* read kernel events of line request */
+		if (ev[i].data.u64 & D_GPIO_EPOLL_CDEV) {
+			if (sRpiGpioCdevReadEvents((int)(uint32_t)ev[i].data.u64,
+									   &events[*num], max - *num, &cdev_num, 0U) != E_OK) {
+				return E_OBJ;
+			}
+			*num += cdev_num;
+			continue;
+		}
+
+		pin = (uint8_t)ev[i].data.u64;
+		if (rpiGpioGet(pin, &events[*num].level) != E_OK) {
+			return E_OBJ;
+		}
+		events[*num].pin       = pin;
+		events[*num].timestamp = timestamp;
+		(*num)++;
+	}
+
+	return E_OK;
+}
+
+/*------------------------------------------------------------------------------
+	Functions (Internal)
+------------------------------------------------------------------------------*/
+/**
+ * @brief GPIO Port Open
+ *
+ * @param [in]	pin		number of GPIO pin
+ * @param [in]	dir		direction
+ *		@args D_GPIO_DIR_IN		input direction
+ *		@args D_GPIO_DIR_OUT	output direction
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioOpen(uint8_t pin, uint8_t dir)
+{
+	struct timespec deadline;
+	int8_t ret;
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(g_gpio_port[pin].fd == D_FD_NOT_OPENED);
+
+	/* request line of character device */
+	if (g_gpio_backend == D_GPIO_BACKEND_CDEV) {
+		return sRpiGpioCdevRequest(&pin, &dir, 1);
+	}
+
+	/* line held by a line request cannot be exported */
+	if (g_gpio_port[pin].held != D_FD_NOT_OPENED) {
+		fprintf(stderr, "GPIO pin %d is held by a line request\n", pin);
+		return E_OBJ;
+	}
+
+	/* declare GPIO pin */
+	if ((ret = sRpiGpioExport(pin)) != E_OK) {
+		return ret;
+	}
+
+	/* wait for gpio file generation */
+	sRpiGpioGetDeadline(&deadline);
+	if ((ret = sRpiGpioWaitReady(pin, &deadline)) != E_OK) {
+		return ret;
+	}
+
+	/* declare GPIO direction */
+	return sRpiGpioSetup(pin, dir);
+}
+
+/**
+ * @brief GPIO Port Export
+ *
+ * A pin which is already exported (EBUSY) is not treated as an error.
+ *
+ * @param [in]	pin		number of GPIO pin
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioExport(uint8_t pin)
+{
+	char pin_str[D_LENGTH_PIN];
+	int fd;
+	int8_t ret = E_OK;
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(sizeof("") + M_DIGIT_SIZE(pin) <= D_LENGTH_PIN);
+
+	/* open file path */
+	if ((fd = open(D_DIR_GPIO "export", O_WRONLY)) == -1) {
+		perror("open");
+		return E_OBJ;
+	}
+
+	/* declare GPIO pin */
+	sprintf(pin_str, "%d", pin);
+	if (write(fd, pin_str, M_DIGIT_SIZE(pin)) != M_DIGIT_SIZE(pin)) {
+		if (errno != EBUSY) {
+			perror("write");
+			ret = E_OBJ;
+		}
+	}
+
+	/* close file path */
+	if (close(fd) == -1) {
+		perror("close");
+		ret = E_OBJ;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief GPIO Port Ready Waiting
+ *
+ * Waits until "gpioN/direction" exists and is writable.
+ * sysfs does not report the creation of kernel objects via inotify,
+ * so the file is polled with an exponentially growing interval instead.
+ *
+ * @param [in]	pin			number of GPIO pin
+ * @param [in]	deadline	absolute time limit (CLOCK_MONOTONIC)
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioWaitReady(uint8_t pin, const struct timespec *deadline)
+{
+	char path_str[D_LENGTH_PATH];
+	struct timespec now;
+	int64_t remain;
+	uint32_t interval = D_POLL_MIN_FILEGEN;
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(deadline != NULL);
+	assert(sizeof(D_DIR_GPIO "gpio/direction") + M_DIGIT_SIZE(pin) <= D_LENGTH_PATH);
+
+	sprintf(path_str, D_DIR_GPIO "gpio%d/direction", pin);
+	while (access(path_str, W_OK) == -1) {
+		/* check timeout */
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		remain = (int64_t)(deadline->tv_sec  - now.tv_sec) * 1000000 +
+						 (deadline->tv_nsec - now.tv_nsec) / 1000;
+		if (remain <= 0) {
+			fprintf(stderr, "%s: timeout\n", path_str);
+			return E_OBJ;
+		}
+
+		/* wait for next polling */
+		usleep((remain < interval) ? (useconds_t)remain : interval);
+		if (interval < D_POLL_MAX_FILEGEN) {
+			interval <<= 1;
+		}
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Port Setup
+ *
+ * @param [in]	pin		number of GPIO pin
+ * @param [in]	dir		direction
+ *		@args D_GPIO_DIR_IN		input direction
+ *		@args D_GPIO_DIR_OUT	output direction
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioSetup(uint8_t pin, uint8_t dir)
+{
+	char path_str[D_LENGTH_PATH];
+	const T_GPIO_ATTR_INFO *info;
+	int8_t ret;
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(M_CHECK_DIR(dir));
+	assert(sizeof(D_DIR_GPIO "gpio/direction") + M_DIGIT_SIZE(pin) <= D_LENGTH_PATH);
+	info = &g_gpio_dir_info[dir];
+
+	/* check port (the same pin may be listed twice in rpiGpioOpenMany) */
+	if (g_gpio_port[pin].fd != D_FD_NOT_OPENED) {
+		fprintf(stderr, "GPIO pin %d is already opened\n", pin);
+		return E_OBJ;
+	}
+
+	/* declare GPIO direction */
+	sprintf(path_str, D_DIR_GPIO "gpio%d/direction", pin);
+	if ((ret = sRpiGpioWrite(path_str, info->str, info->size)) != E_OK) {
+		return ret;
+	}
+
+	/* keep "value" file opened until rpiGpioClose() */
+	sprintf(path_str, D_DIR_GPIO "gpio%d/value", pin);
+	if ((g_gpio_port[pin].fd = open(path_str, info->flags)) == -1) {
+		perror("open");
+		g_gpio_port[pin].fd = D_FD_NOT_OPENED;
+		return E_OBJ;
+	}
+	g_gpio_port[pin].backend = D_GPIO_BACKEND_SYSFS;
+	g_gpio_port[pin].dir     = dir;
+	g_gpio_port[pin].edge    = D_GPIO_EDGE_NONE;
+	g_gpio_port[pin].event   = 0U;
+
+	return E_OK;
+}
+
+/**
+ * @brief Deadline Calculation for GPIO File Generation
+ *
+ * @param [out]	deadline	absolute time limit (CLOCK_MONOTONIC)
+ *
+ * @return nothing
+ */
+static void sRpiGpioGetDeadline(struct timespec *deadline)
+{
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec  += g_gpio_timeout / 1000000;
+	deadline->tv_nsec += (g_gpio_timeout % 1000000) * 1000;
+	if (deadline->tv_nsec >= 1000000000L) {
+		deadline->tv_sec  += 1;
+		deadline->tv_nsec -= 1000000000L;
+	}
+}
+
+/**
+ * @brief GPIO Port Value Setting
+ *
+ * @param [in]	pin			number of GPIO pin
+ * @param [in]	val_str		string of value
+ *		@args "0"	low level
+ *		@args "1"	high level
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioSetValue(uint8_t pin, char *val_str)
+{
+	char path_str[D_LENGTH_PATH];
+
+	/* check parameter */
+	assert(M_CHECK_PIN(pin));
+	assert(sizeof(D_DIR_GPIO "gpio/value") + M_DIGIT_SIZE(pin) <= D_LENGTH_PATH);
+
+	/* write GPIO pin through the line request */
+	if (M_IS_CDEV(pin)) {
+		return sRpiGpioCdevSetValue(pin, val_str[0] - '0');
+	}
+
+	/* write GPIO pin exported by others */
+	if (g_gpio_port[pin].fd == D_FD_NOT_OPENED) {
+		sprintf(path_str, D_DIR_GPIO "gpio%d/value", pin);
+		return sRpiGpioWrite(path_str, val_str, D_LENGTH_VAL);
+	}
+
+	/* write GPIO pin through the opened "value" file */
+	if (pwrite(g_gpio_port[pin].fd, val_str, D_LENGTH_VAL, 0) != D_LENGTH_VAL) {
+		perror("pwrite");
+		return E_OBJ;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Port Value Parsing
+ *
+ * @param [in]	val_char	character read from "value" file
+ * @param [out]	val			address of pin level (0 or 1)
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioParseValue(char val_char, int32_t *val)
+{
+	switch (val_char) {
+	case '0':
+		*val = 0;
+		return E_OK;
+	case '1':
+		*val = 1;
+		return E_OK;
+	default:
+		fprintf(stderr, "invalid GPIO value '%c'\n", val_char);
+		return E_OBJ;
+	}
+}
+
+/**
+ * @brief Write to File
+ *
+ * @param [in]	path		file path
+ * @param [in]	str			string to be wrote
+ * @param [in]	str_size	byte-size of string to be wrote
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioWrite(char *path, char *str, uint8_t str_size)
+{
+	int fd;
+	int8_t ret = E_OK;
+
+	/* open file path */
+	if ((fd = open(path, O_WRONLY)) == -1) {
+		perror("open");
+		ret = E_OBJ;
+	} else {
+		/* write to the file */
+		if (write(fd, str, str_size) != str_size) {
+			perror("write");
+			ret = E_OBJ;
+		}
+
+		/* close file path */
+		if (close(fd) == -1) {
+			perror("close");
+			ret = E_OBJ;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Read from File
+ *
+ * @param [in]	path		file path
+ * @param [in]	str			string to be wrote
+ * @param [in]	str_size	byte-size of string to be read
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioRead(char *path, char *str, uint8_t str_size)
+{
+	int fd;
+	int8_t ret = E_OK;
+
+	/* open file path */
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		perror("open");
+		ret = E_OBJ;
+	} else {
+		/* read from the file */
+		if (read(fd, str, str_size) != str_size) {
+			perror("read");
+			ret = E_OBJ;
+		}
+
+		/* close file path */
+		if (close(fd) == -1) {
+			perror("close");
+			ret = E_OBJ;
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * @brief GPIO Line Request (Character Device)
+ *
+ * @param [in]	pins	array of GPIO pin numbers (line offsets of the chip)
+ * @param [in]	dirs	array of directions
+ * @param [in]	num		number of elements (1 - GPIO_V2_LINES_MAX)
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioCdevRequest(const uint8_t *pins, const uint8_t *dirs, size_t num)
+{
+	struct gpio_v2_line_request req;
+	int chip_fd;
+	int8_t ret = E_OK;
+	size_t i;
+
+	/* check parameter */
+	assert(pins != NULL);
+	assert(dirs != NULL);
+	assert((num > 0) && (num <= GPIO_V2_LINES_MAX));
+
+	/* reuse line request still holding the pin */
+	if ((num == 1) && (g_gpio_port[pins[0]].held != D_FD_NOT_OPENED)) {
+		return sRpiGpioCdevReuse(pins[0], dirs[0]);
+	}
+
+	/* make request */
+	memset(&req, 0, sizeof(req));
+	for (i = 0; i < num; i++) {
+		assert(M_CHECK_PIN(pins[i]));
+		assert(M_CHECK_DIR(dirs[i]));
+		req.offsets[i] = pins[i];
+		g_gpio_port[pins[i]].line = (uint8_t)i;
+		g_gpio_port[pins[i]].dir  = dirs[i];
+		g_gpio_port[pins[i]].edge = D_GPIO_EDGE_NONE;
+	}
+	req.num_lines = num;
+	strncpy(req.consumer, D_GPIO_CONSUMER, sizeof(req.consumer) - 1);
+	sRpiGpioCdevBuildConfig(pins, num, &req.config);
+
+	/* open GPIO character device */
+	if ((chip_fd = open(g_gpio_chip, O_RDWR | O_CLOEXEC)) == -1) {
+		perror("open");
+		return E_OBJ;
+	}
+
+	/* request lines */
+	if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) == -1) {
+		perror("ioctl");
+		ret = E_OBJ;
+	} else {
+		for (i = 0; i < num; i++) {
+			g_gpio_port[pins[i]].fd      = req.fd;
+			g_gpio_port[pins[i]].backend = D_GPIO_BACKEND_CDEV;
+			g_gpio_port[pins[i]].event   = 0U;
+		}
+	}
+
+	/* close GPIO character device (the line request stays valid) */
+	if (close(chip_fd) == -1) {
+		perror("close");
+		ret = E_OBJ;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief GPIO Line Reuse (Character Device)
+ *
+ * Opens a pin again in the line request which still holds it.
+ *
+ * @param [in]	pin		number of GPIO pin
+ * @param [in]	dir		direction
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioCdevReuse(uint8_t pin, uint8_t dir)
+{
+	int fd = g_gpio_port[pin].held;
+
+	g_gpio_port[pin].fd      = fd;
+	g_gpio_port[pin].held    = D_FD_NOT_OPENED;
+	g_gpio_port[pin].backend = D_GPIO_BACKEND_CDEV;
+	g_gpio_port[pin].dir     = dir;
+	g_gpio_port[pin].edge    = D_GPIO_EDGE_NONE;
+	g_gpio_port[pin].event   = 0U;
+
+	/* reconfigure lines with the direction of the pin */
+	if (sRpiGpioCdevConfig(fd) != E_OK) {
+		g_gpio_port[pin].fd   = D_FD_NOT_OPENED;
+		g_gpio_port[pin].held = fd;
+		return E_OBJ;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Line Release (Character Device)
+ *
+ * The line request is closed when its last pin is released.
+ * Until then, the released line is reconfigured as an input and stays held
+ * by the line request, so that the pin can be opened again (sRpiGpioCdevReuse()).
+ *
+ * @param [in]	pin		number of GPIO pin
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioCdevRelease(uint8_t pin)
+{
+	int fd = g_gpio_port[pin].fd;
+	uint8_t i;
+
+	/* check parameter */
+	assert(M_IS_CDEV(pin));
+
+	g_gpio_port[pin].fd    = D_FD_NOT_OPENED;
+	g_gpio_port[pin].event = 0U;
+
+	/* keep line request opened while other pins use it */
+	for (i = 0; i < D_GPIO_PIN_NUM; i++) {
+		if (M_IS_CDEV(i) && (g_gpio_port[i].fd == fd)) {
+			g_gpio_port[pin].held = fd;
+
+			/* reconfigure the released line as an input */
+			return sRpiGpioCdevConfig(fd);
+		}
+	}
+
+	/* close line request (and forget the pins held by it) */
+	for (i = 0; i < D_GPIO_PIN_NUM; i++) {
+		if (g_gpio_port[i].held == fd) {
+			g_gpio_port[i].held = D_FD_NOT_OPENED;
+		}
+	}
+	if (close(fd) == -1) {
+		perror("close");
+		return E_OBJ;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Line Reconfiguration (Character Device)
+ *
+ * Output lines keep their current levels, since the kernel drives output lines
+ * without an output value attribute low.
+ *
+ * @param [in]	fd		file descriptor of line request
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioCdevConfig(int fd)
+{
+	struct gpio_v2_line_config config;
+	struct gpio_v2_line_values lv;
+	uint8_t pins[GPIO_V2_LINES_MAX];
+	size_t num = 0;
+	uint8_t i;
+
+	/* collect pins of line request in order of line index */
+	memset(pins, D_PIN_INVALID, sizeof(pins));
+	for (i = 0; i < D_GPIO_PIN_NUM; i++) {
+		if (M_IS_CDEV(i) && (g_gpio_port[i].fd == fd)) {
+			pins[g_gpio_port[i].line] = i;
+			if (num < g_gpio_port[i].line + 1U) {
+				num = g_gpio_port[i].line + 1U;
+			}
+		}
+	}
+
+	/* reconfigure all lines */
+	sRpiGpioCdevBuildConfig(pins, num, &config);
+
+	/* keep current levels of output lines */
+	lv.mask = 0ULL;
+	lv.bits = 0ULL;
+	for (i = 0; i < num; i++) {
+		if ((pins[i] != D_PIN_INVALID) && (g_gpio_port[pins[i]].dir == D_GPIO_DIR_OUT)) {
+			lv.mask |= 1ULL << i;
+		}
+	}
+	if (lv.mask != 0ULL) {
+		if (ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv) == -1) {
+			perror("ioctl");
+			return E_OBJ;
+		}
+		config.attrs[config.num_attrs].attr.id     = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+		config.attrs[config.num_attrs].attr.values = lv.bits;
+		config.attrs[config.num_attrs].mask        = lv.mask;
+		config.num_attrs++;
+	}
+
+	if (ioctl(fd, GPIO_V2_LINE_SET_CONFIG_IOCTL, &config) == -1) {
+		perror("ioctl");
+		return E_OBJ;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Line Configuration Build (Character Device)
+ *
+ * Lines with the same direction and edge share one attribute.
+ * Lines not listed (D_PIN_INVALID) get the default configuration (input).
+ *
+ * @param [in]	pins	array of GPIO pin numbers in order of line index
+ * @param [in]	num		number of elements
+ * @param [out]	config	address of line configuration
+ *
+ * @return nothing
+ */
+static void sRpiGpioCdevBuildConfig(const uint8_t *pins, size_t num, struct gpio_v2_line_config *config)
+{
+	static const uint64_t edge_flags[] = {
+		0ULL,															/* D_GPIO_EDGE_NONE */
+		GPIO_V2_LINE_FLAG_EDGE_RISING,									/* D_GPIO_EDGE_RISING */
+		GPIO_V2_LINE_FLAG_EDGE_FALLING,									/* D_GPIO_EDGE_FALLING */
+		GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING,	/* D_GPIO_EDGE_BOTH */
+	};
+	const T_GPIO_PORT *port;
+	uint64_t flags;
+	uint32_t k;
+	size_t i;
+
+	memset(config, 0, sizeof(*config));
+	config->flags = GPIO_V2_LINE_FLAG_INPUT;
+
+	for (i = 0; i < num; i++) {
+		if (pins[i] == D_PIN_INVALID) {
+			continue;
+		}
+		port = &g_gpio_port[pins[i]];
+
+		/* flags of line */
+		if (port->dir == D_GPIO_DIR_OUT) {
+			flags = GPIO_V2_LINE_FLAG_OUTPUT;
+		} else if (port->edge == D_GPIO_EDGE_NONE) {
+			flags = GPIO_V2_LINE_FLAG_INPUT;
+		} else {
+			flags = GPIO_V2_LINE_FLAG_INPUT | edge_flags[port->edge] | D_GPIO_EVENT_CLOCK;
+		}
+
+		/* share attribute with the same flags (at most 5 kinds of flags) */
+		for (k = 0; k < config->num_attrs; k++) {
+			if (config->attrs[k].attr.flags == flags) {
+				break;
+			}
+		}
+		if (k == config->num_attrs) {
+			config->attrs[k].attr.id    = GPIO_V2_LINE_ATTR_ID_FLAGS;
+			config->attrs[k].attr.flags = flags;
+			config->num_attrs++;
+		}
+		config->attrs[k].mask |= 1ULL << i;
+	}
+}
+
+/**
+ * @brief GPIO Line Value Setting (Character Device)
+ *
+ * @param [in]	pin		number of GPIO pin
+ * @param [in]	val		pin level (0 or 1)
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioCdevSetValue(uint8_t pin, int32_t val)
+{
+	struct gpio_v2_line_values lv;
+
+	lv.mask = 1ULL << g_gpio_port[pin].line;
+	lv.bits = val ? lv.mask : 0ULL;
+	if (ioctl(g_gpio_port[pin].fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv) == -1) {
+		perror("ioctl");
+		return E_OBJ;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Line Value Getting (Character Device)
+ *
+ * @param [in]	pin		number of GPIO pin
+ * @param [out]	val		address of pin level (0 or 1)
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioCdevGetValue(uint8_t pin, int32_t *val)
+{
+	struct gpio_v2_line_values lv;
+
+	lv.mask = 1ULL << g_gpio_port[pin].line;
+	lv.bits = 0ULL;
+	if (ioctl(g_gpio_port[pin].fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv) == -1) {
+		perror("ioctl");
+		return E_OBJ;
+	}
+
+	*val = (lv.bits & lv.mask) ? 1 : 0;
+	return E_OK;
+}
+
+/**
+ * @brief GPIO Line Events Read (Character Device)
+ *
+ * @param [in]	fd		file descriptor of line request
+ * @param [out]	events	array of events
+ * @param [in]	max		number of elements of events
+ * @param [out]	num		address of number of stored events
+ * @param [in]	all		events to be stored
+ *		@arg 0	events of pins registered by rpiGpioEventAdd() only
+ *		@arg 1	events of all pins
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiGpioCdevReadEvents(int fd, T_GPIO_EVENT *events, uint32_t max, uint32_t *num, uint8_t all)
+{
+	struct gpio_v2_line_event buf[D_GPIO_EVENT_BUF];
+	ssize_t size;
+	uint32_t i;
+	uint8_t pin;
+
+	*num = 0;
+	if (max > D_GPIO_EVENT_BUF) {
+		max = D_GPIO_EVENT_BUF;
+	}
+
+	/* read whole events (the kernel never splits an event) */
+	if ((size = read(fd, buf, sizeof(buf[0]) * max)) == -1) {
+		if (errno == EAGAIN) {
+			return E_OK;
+		}
+		perror("read");
+		return E_OBJ;
+	}
+
+	for (i = 0; i < size / sizeof(buf[0]); i++) {
+		pin = (uint8_t)buf[i].offset;
+		if (!M_CHECK_PIN(pin) || (!all && !g_gpio_port[pin].event)) {
+			continue;
+		}
+		events[*num].pin       = pin;
+		events[*num].level     = (buf[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE) ? 1 : 0;
+		events[*num].timestamp = buf[i].timestamp_ns;
+		(*num)++;
+	}
+
+	return E_OK;
 }
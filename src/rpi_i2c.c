@@ -20,6 +20,7 @@
 #include <string.h>
 #include <assert.h>
 #include "rpi_i2c.h"
+#include "rpi_instrument.h"
 
 /*------------------------------------------------------------------------------
 	Defined Macros
@@ -45,6 +46,8 @@ static int g_i2c_fd = D_FD_NOT_OPENED;		/**< file descriptor */
  */
 int8_t rpiI2cOpen(uint8_t *dev_path)
 {
+	M_INSTRUMENT_FUNC(I2C_OPEN);
+
 	/* check parameter */
 	assert(dev_path != NULL);
 
@@ -76,6 +79,8 @@ int8_t rpiI2cOpen(uint8_t *dev_path)
  */
 int8_t rpiI2cClose()
 {
+	M_INSTRUMENT_FUNC(I2C_CLOSE);
+
 	/* check port */
 	assert(g_i2c_fd != D_FD_NOT_OPENED);
 
@@ -101,6 +106,8 @@ int8_t rpiI2cClose()
  */
 int8_t rpiI2cSetSlave(uint8_t slave_addr)
 {
+	M_INSTRUMENT_FUNC(I2C_SET_SLAVE);
+
 	/* set slave address */
 	if (ioctl(g_i2c_fd, I2C_SLAVE, slave_addr) == -1) {
 		perror("ioctl");
@@ -123,6 +130,8 @@ int8_t rpiI2cWrite(uint8_t cmd, uint8_t data)
 {
 	uint8_t buf_tx[2];
 
+	M_INSTRUMENT_FUNC(I2C_WRITE);
+
 	/* write command + master data */
 	buf_tx[0] = cmd;
 	buf_tx[1] = data;
@@ -145,6 +154,8 @@ int8_t rpiI2cWrite(uint8_t cmd, uint8_t data)
  */
 int8_t rpiI2cRead(uint8_t cmd, uint8_t *data)
 {
+	M_INSTRUMENT_FUNC(I2C_READ);
+
 	/* check parameter */
 	assert(data != NULL);
 
@@ -177,6 +188,8 @@ int8_t rpiI2cWriteBlock(uint8_t cmd, uint8_t *buf, uint32_t size)
 {
 	uint8_t *buf_tx;
 
+	M_INSTRUMENT_FUNC(I2C_WRITE_BLOCK);
+
 	/* check parameter */
 	assert(buf != NULL);
 
@@ -212,6 +225,8 @@ int8_t rpiI2cWriteBlock(uint8_t cmd, uint8_t *buf, uint32_t size)
  */
 int8_t rpiI2cReadBlock(uint8_t cmd, uint8_t *buf, uint32_t size)
 {
+	M_INSTRUMENT_FUNC(I2C_READ_BLOCK);
+
 	/* check parameter */
 	assert(buf != NULL);
 
@@ -0,0 +1,205 @@
+/**
+ * @file		rpi_instrument.c
+ * @brief		Instrumentation Library Implementation
+ *
+ * Compiled only with RPI_INSTRUMENT (e.g. make INSTRUMENT=1).
+ *
+ * @author		T. Ngtk
+ * @copyright	Copyright (c) 2016 T. Ngtk
+ *
+ * @par License
+ *	Released under the MIT License.<BR>
+ *	https://github.com/ngtkt0909/raspberry-pi-gpio/blob/master/LICENSE
+ */
+
+#include "rpi_instrument.h"
+
+#ifdef RPI_INSTRUMENT
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/*------------------------------------------------------------------------------
+	Defined Macros
+------------------------------------------------------------------------------*/
+#define D_LENGTH_SHM_NAME	(32)		/**< maximum string length for name of shared memory */
+
+#define M_INSTRUMENT_GEN_NAME(id, name)	name,		/**< generate name of entry point */
+
+/*------------------------------------------------------------------------------
+	Prototype Declaration
+------------------------------------------------------------------------------*/
+static void sRpiInstrumentSetup() __attribute__((constructor));
+static void sRpiInstrumentCleanup() __attribute__((destructor));
+static void sRpiInstrumentFill(T_INSTRUMENT_DATA *data);
+
+/*------------------------------------------------------------------------------
+	Global Variables
+------------------------------------------------------------------------------*/
+static T_INSTRUMENT_DATA g_instrument_local;						/**< data used if shared memory is not available */
+T_INSTRUMENT_DATA *g_instrument_data = &g_instrument_local;			/**< instrumentation data */
+static char g_instrument_shm_name[D_LENGTH_SHM_NAME] = {'\0'};		/**< name of shared memory ('\0': not created) */
+
+/** names of entry points */
+static const char *g_instrument_fn_name[D_INSTRUMENT_FN_NUM] = {
+	M_INSTRUMENT_FUNCS(M_INSTRUMENT_GEN_NAME)
+};
+
+/*------------------------------------------------------------------------------
+	Functions (External)
+------------------------------------------------------------------------------*/
+/**
+ * @brief Getter of Instrumentation Data
+ *
+ * @param nothing
+ *
+ * @return instrumentation data (also readable from shared memory D_INSTRUMENT_SHM_NAME)
+ */
+T_INSTRUMENT_DATA *rpiInstrumentData()
+{
+	return g_instrument_data;
+}
+
+/**
+ * @brief Reset Instrumentation Data
+ *
+ * Counters are cleared without stopping the accessors,
+ * so counts of concurrent calls may be lost.
+ *
+ * @param nothing
+ *
+ * @return nothing
+ */
+void rpiInstrumentReset()
+{
+	T_INSTRUMENT_DATA *data = g_instrument_data;
+
+	memset(data->reg_read, 0, sizeof(data->reg_read));
+	memset(data->reg_write, 0, sizeof(data->reg_write));
+	memset(data->spin, 0, sizeof(data->spin));
+	memset(data->calls, 0, sizeof(data->calls));
+	memset(data->hist, 0, sizeof(data->hist));
+}
+
+/**
+ * @brief Current Time
+ *
+ * @param nothing
+ *
+ * @return time of CLOCK_MONOTONIC_RAW [ns]
+ */
+uint64_t rpiInstrumentNow()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief End of Latency Measurement Scope (called by M_INSTRUMENT_FUNC())
+ *
+ * @param [in]	scope	latency measurement scope
+ *
+ * @return nothing
+ */
+void rpiInstrumentScopeEnd(T_INSTRUMENT_SCOPE *scope)
+{
+	uint64_t elapsed = rpiInstrumentNow() - scope->start;
+	uint32_t bin = 63 - __builtin_clzll(elapsed | 1ULL);
+
+	if (bin >= D_INSTRUMENT_HIST_BINS) {
+		bin = D_INSTRUMENT_HIST_BINS - 1;
+	}
+
+	rpiInstrumentCount(&g_instrument_data->calls[scope->id]);
+	rpiInstrumentCount(&g_instrument_data->hist[scope->id][bin]);
+}
+
+/*------------------------------------------------------------------------------
+	Functions (Internal)
+------------------------------------------------------------------------------*/
+/**
+ * @brief Create Shared Memory (at load time)
+ *
+ * @param nothing
+ *
+ * @return nothing
+ */
+static void sRpiInstrumentSetup()
+{
+	T_INSTRUMENT_DATA *data;
+	char name[D_LENGTH_SHM_NAME];
+	int fd;
+
+	sRpiInstrumentFill(&g_instrument_local);
+
+	snprintf(name, sizeof(name), D_INSTRUMENT_SHM_NAME, (int)getpid());
+	if ((fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0) {
+		perror("shm_open");
+		return;
+	}
+
+	if (ftruncate(fd, sizeof(T_INSTRUMENT_DATA)) < 0) {
+		perror("ftruncate");
+		close(fd);
+		shm_unlink(name);
+		return;
+	}
+
+	data = mmap(NULL, sizeof(T_INSTRUMENT_DATA), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		perror("mmap");
+		shm_unlink(name);
+		return;
+	}
+
+	sRpiInstrumentFill(data);
+	strcpy(g_instrument_shm_name, name);
+	g_instrument_data = data;
+}
+
+/**
+ * @brief Remove Shared Memory (at exit)
+ *
+ * @param nothing
+ *
+ * @return nothing
+ */
+static void sRpiInstrumentCleanup()
+{
+	if (g_instrument_shm_name[0] != '\0') {
+		shm_unlink(g_instrument_shm_name);
+	}
+}
+
+/**
+ * @brief Fill Header of Instrumentation Data
+ *
+ * @param [out]	data	instrumentation data
+ *
+ * @return nothing
+ */
+static void sRpiInstrumentFill(T_INSTRUMENT_DATA *data)
+{
+	uint32_t i;
+
+	memset(data, 0, sizeof(*data));
+	data->magic   = D_INSTRUMENT_MAGIC;
+	data->version = D_INSTRUMENT_VERSION;
+	data->reg_num = D_INSTRUMENT_REG_NUM;
+	data->fn_num  = D_INSTRUMENT_FN_NUM;
+	for (i = 0; i < D_INSTRUMENT_FN_NUM; i++) {
+		strncpy(data->name[i], g_instrument_fn_name[i], D_INSTRUMENT_NAME_SIZE - 1);
+	}
+}
+
+#endif /* RPI_INSTRUMENT */
@@ -10,18 +10,28 @@
  *	https://github.com/ngtkt0909/raspberry-pi-gpio/blob/master/LICENSE
  */
 
+#define _FILE_OFFSET_BITS	64		/* peripheral base of BCM2711 exceeds 2GB */
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
 #include <assert.h>
 #include "rpi_regmap.h"
 
 /*------------------------------------------------------------------------------
 	Defined Macros
 ------------------------------------------------------------------------------*/
+#define D_DEV_MEM			"/dev/mem"				/**< physical memory */
+#define D_DEV_GPIOMEM		"/dev/gpiomem"			/**< GPIO registers (no root privilege needed) */
+#define D_DIR_DEVICE_TREE	"/proc/device-tree"		/**< device tree */
+#define D_LENGTH_PATH		(256)					/**< maximum string length for path */
+
 /** check base address of GPIO */
 #define M_CHECK_BASE_GPIO()	(g_regmap_base_gpio != NULL)
 
@@ -31,9 +41,19 @@
 /** check number of GPIO pin */
 #define M_CHECK_PIN(pin)	((pin >= 0) && (pin <= 53))
 
+/** check bank of GPIO pin */
+#define M_CHECK_BANK(bank)	((bank >= 0) && (bank <= 1))
+
 /** check channel of clock manager */
 #define M_CHECK_CM_CH(ch)	((ch >= 0) && (ch<= 2))
 
+/** check slot of configuration register */
+#define M_CHECK_SLOT(slot)	((slot >= 0) && (slot < D_RPI_SLOT_NUM))
+
+/** check mode of shadow cache */
+#define M_CHECK_SHADOW(mode) \
+	((mode >= D_RPI_SHADOW_OFF) && (mode <= D_RPI_SHADOW_VALIDATE))
+
 /** check CM_GPnCTL.MASH */
 #define M_CHECK_CM_MASH(mash) \
 	((mash >= D_RPI_CMGPCTL_MASH_INT) && (mash <= D_RPI_CMGPCTL_MASH_3STAGE))
@@ -46,11 +66,37 @@
 #define M_CHECK_CM_SRC(src) \
 	((src >= D_RPI_CMGPCTL_SRC_GND) && (src <= D_RPI_CMGPCTL_SRC_HDMI))
 
+/*------------------------------------------------------------------------------
+	Prototype Declaration
+------------------------------------------------------------------------------*/
+static int8_t sRpiRegmapMap();
+static int8_t sRpiRegmapMapSim(const char *path);
+static uint32_t sRpiRegmapReadCell(const uint8_t *cell);
+static volatile uint32_t *sRpiRegmapSlotAddr(uint8_t slot);
+static uint32_t sRpiRegmapSlotIgnore(uint8_t slot);
+
 /*------------------------------------------------------------------------------
 	Global Variables
 ------------------------------------------------------------------------------*/
-static volatile uint8_t *g_regmap_base_gpio = NULL;		/**< base address of GPIO */
-static volatile uint8_t *g_regmap_base_cm   = NULL;		/**< base address of clock manager */
+volatile uint8_t *g_regmap_base_gpio = NULL;			/**< base address of GPIO */
+volatile uint8_t *g_regmap_base_cm   = NULL;			/**< base address of clock manager */
+static uint32_t g_regmap_base_peri = D_RPI_BASE_PERI;	/**< physical base address of peripherals */
+T_RPI_REGMAP_HOOK g_regmap_hook = NULL;					/**< write hook (NULL: write to registers) */
+
+uint32_t g_regmap_shadow[D_RPI_SLOT_NUM];				/**< shadow cache of configuration registers */
+uint8_t g_regmap_shadow_mode = D_RPI_SHADOW_OFF;		/**< mode of shadow cache */
+static uint32_t g_regmap_shadow_errors = 0;				/**< number of mismatches detected in validation mode */
+
+static T_RPI_REGMAP_LOG *g_regmap_sim_log = NULL;		/**< write log of simulated registers (NULL: not logged) */
+static uint32_t g_regmap_sim_log_max = 0;				/**< maximum number of logged writes */
+static uint32_t g_regmap_sim_log_num = 0;				/**< number of writes (including not logged ones) */
+
+uint8_t g_regmap_lock[D_RPI_SLOT_NUM];					/**< spinlocks of configuration registers */
+uint8_t g_regmap_lock_enabled = 0U;						/**< concurrency-safe mode or not */
+
+static uint32_t g_regmap_refcnt = 0;					/**< number of acquired sessions */
+static pthread_mutex_t g_regmap_mutex = PTHREAD_MUTEX_INITIALIZER;
+														/**< lock for mapping and reference count */
 
 /*------------------------------------------------------------------------------
 	Functions
@@ -58,6 +104,9 @@ static volatile uint8_t *g_regmap_base_cm   = NULL;		/**< base address of clock
 /**
  * @brief Initialize Register Map
  *
+ * Equivalent to rpiRegmapAcquire() without a session handle.
+ * Calling it more than once does not map the registers again.
+ *
  * @param nothing
  *
  * @retval E_OK		success
@@ -65,72 +114,705 @@ static volatile uint8_t *g_regmap_base_cm   = NULL;		/**< base address of clock
  */
 int8_t rpiRegmapInit()
 {
-	int fd;
-	void *mmap_gpio, *mmap_cm;
 	int8_t ret = E_OK;
 
-	if ((fd = open("/dev/mem", O_RDWR | O_SYNC)) == -1) {
-		perror("open");
+	M_INSTRUMENT_FUNC(REGMAP_INIT);
+
+	pthread_mutex_lock(&g_regmap_mutex);
+
+	/* map registers at the first session */
+	if (g_regmap_base_gpio == NULL) {
+		ret = sRpiRegmapMap();
+	}
+	if (ret == E_OK) {
+		g_regmap_refcnt++;
+	}
+
+	pthread_mutex_unlock(&g_regmap_mutex);
+
+	return ret;
+}
+
+/**
+ * @brief Finalize Register Map
+ *
+ * Equivalent to rpiRegmapRelease() without a session handle.
+ * The registers stay mapped for the life of the process, so other modules
+ * still using them are not affected.
+ *
+ * @param nothing
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiRegmapFinal()
+{
+	int8_t ret = E_OK;
+
+	M_INSTRUMENT_FUNC(REGMAP_FINAL);
+
+	pthread_mutex_lock(&g_regmap_mutex);
+
+	if (g_regmap_refcnt == 0) {
+		fprintf(stderr, "rpiRegmapFinal: not initialized\n");
 		ret = E_OBJ;
 	} else {
-		/* map GPIO */
-		if ((mmap_gpio = mmap(NULL, D_RPI_BLOCK_SIZE,
-							PROT_READ | PROT_WRITE, MAP_SHARED,
-							fd, D_RPI_BASE_GPIO)) == MAP_FAILED) {
-			perror("mmap");
-			ret = E_OBJ;
-		} else {
-			g_regmap_base_gpio = (volatile uint8_t *)mmap_gpio;
+		g_regmap_refcnt--;
+	}
+
+	pthread_mutex_unlock(&g_regmap_mutex);
+
+	return ret;
+}
+
+/**
+ * @brief Acquire Register Map Session
+ *
+ * The registers are mapped by the first session and kept mapped for the
+ * life of the process, so acquiring a session costs no system call after
+ * the first one.
+ *
+ * @param [out]	session	address of session handle
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiRegmapAcquire(T_RPI_REGMAP_SESSION *session)
+{
+	int8_t ret;
+
+	/* check parameter */
+	assert(session != NULL);
+	assert(!session->acquired);
+
+	if ((ret = rpiRegmapInit()) == E_OK) {
+		session->acquired = 1U;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Release Register Map Session
+ *
+ * @param [in,out]	session	address of session handle
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiRegmapRelease(T_RPI_REGMAP_SESSION *session)
+{
+	int8_t ret;
+
+	/* check parameter */
+	assert(session != NULL);
+	assert(session->acquired);
+
+	if ((ret = rpiRegmapFinal()) == E_OK) {
+		session->acquired = 0U;
+	}
+
+	return ret;
+}
+
+/**
+ * @brief Initialize Register Map (Simulation)
+ *
+ * Maps a regular file (or anonymous memory) as the peripheral window
+ * instead of /dev/mem, and installs rpiRegmapSimWrite() as the write hook.
+ * Must be called before any other session is acquired; afterwards
+ * rpiRegmapInit() and rpiRegmapAcquire() share the simulated registers.
+ *
+ * @param [in]	path	path of backing file (NULL: anonymous memory)
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiRegmapInitSim(const char *path)
+{
+	int8_t ret;
+
+	pthread_mutex_lock(&g_regmap_mutex);
+
+	if (g_regmap_base_gpio != NULL) {
+		fprintf(stderr, "rpiRegmapInitSim: registers are already mapped\n");
+		ret = E_OBJ;
+	} else if ((ret = sRpiRegmapMapSim(path)) == E_OK) {
+		g_regmap_hook = rpiRegmapSimWrite;
+		g_regmap_refcnt++;
+	}
+
+	pthread_mutex_unlock(&g_regmap_mutex);
+
+	return ret;
+}
+
+/**
+ * @brief Setter of Write Hook
+ *
+ * Every register write of this library is passed to the hook instead of
+ * being stored. A hook may call rpiRegmapSimWrite() to keep the simulation
+ * model (e.g. to timestamp each write).
+ *
+ * @param [in]	hook	write hook (NULL: write to registers directly)
+ *
+ * @return nothing
+ */
+void rpiRegmapSetHook(T_RPI_REGMAP_HOOK hook)
+{
+	g_regmap_hook = hook;
+}
+
+/**
+ * @brief Simulated Register Write
+ *
+ * Models side effects of the registers used by this library:
+ * - GPSETn/GPCLRn set/clear bits of GPLEVn (they read back as zero).
+ * - CM_GPnCTL/CM_GPnDIV ignore writes without the password,
+ *   the password field reads back as zero,
+ *   and CM_GPnCTL.BUSY follows CM_GPnCTL.ENAB immediately.
+ * Other registers behave as plain memory.
+ *
+ * @param [in]	addr	address of register
+ * @param [in]	val		value to be written
+ *
+ * @return nothing
+ */
+void rpiRegmapSimWrite(volatile uint32_t *addr, uint32_t val)
+{
+	struct timespec ts;
+	uintptr_t off;
+	uint32_t idx;
+
+	/* timestamp write */
+	if (g_regmap_sim_log != NULL) {
+		idx = __atomic_fetch_add(&g_regmap_sim_log_num, 1U, __ATOMIC_RELAXED);
+		if (idx < g_regmap_sim_log_max) {
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			g_regmap_sim_log[idx].time = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+			g_regmap_sim_log[idx].addr = addr;
+			g_regmap_sim_log[idx].val  = val;
 		}
+	}
 
-		/* map clock manager */
-		if ((mmap_cm = mmap(NULL, D_RPI_BLOCK_SIZE,
-							PROT_READ | PROT_WRITE, MAP_SHARED,
-							fd, D_RPI_BASE_CM)) == MAP_FAILED) {
-			perror("mmap");
-			ret = E_OBJ;
+	/* GPIO block */
+	off = (uintptr_t)addr - (uintptr_t)g_regmap_base_gpio;
+	if ((g_regmap_base_gpio != NULL) && (off < D_RPI_BLOCK_SIZE)) {
+		if ((off == 0x1C) || (off == 0x20)) {
+			__atomic_fetch_or((uint32_t *)M_RPI_ADDR_GPLEV((off - 0x1C) >> 2), val, __ATOMIC_RELAXED);
+		} else if ((off == 0x28) || (off == 0x2C)) {
+			__atomic_fetch_and((uint32_t *)M_RPI_ADDR_GPLEV((off - 0x28) >> 2), ~val, __ATOMIC_RELAXED);
 		} else {
-			g_regmap_base_cm = (volatile uint8_t *)mmap_cm;
+			*addr = val;
+		}
+		return;
+	}
+
+	/* clock manager block (CM_GP0CTL - CM_GP2DIV) */
+	off = (uintptr_t)addr - (uintptr_t)g_regmap_base_cm;
+	if ((g_regmap_base_cm != NULL) && (off >= 0x70) && (off <= 0x84)) {
+		if ((val >> D_RPI_SHAMT_CMGPCTL_PASSWD) != D_RPI_CMGPCTL_PASSWD) {
+			return;
+		}
+		val &= ~D_RPI_MASK_CMGPCTL_PASSWD;
+		if (((off - 0x70) & 0x7) == 0) {
+			val = (val & ~D_RPI_MASK_CMGPCTL_BUSY) |
+				  ((val & D_RPI_MASK_CMGPCTL_ENAB) ? D_RPI_MASK_CMGPCTL_BUSY : 0);
+		}
+	}
+	*addr = val;
+}
+
+/**
+ * @brief Set Write Log of Simulated Registers
+ *
+ * Each write through rpiRegmapSimWrite() is recorded with its time,
+ * up to max writes (the rest is only counted).
+ *
+ * @param [out]	log		array of write log (NULL: stop logging)
+ * @param [in]	max		number of elements of log
+ *
+ * @return nothing
+ */
+void rpiRegmapSimSetLog(T_RPI_REGMAP_LOG *log, uint32_t max)
+{
+	g_regmap_sim_log     = NULL;
+	g_regmap_sim_log_max = max;
+	g_regmap_sim_log_num = 0U;
+	g_regmap_sim_log     = log;
+}
+
+/**
+ * @brief Getter of Number of Logged Writes
+ *
+ * @param nothing
+ *
+ * @return number of writes since rpiRegmapSimSetLog() (may exceed max of the log)
+ */
+uint32_t rpiRegmapSimGetLogNum()
+{
+	return __atomic_load_n(&g_regmap_sim_log_num, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Detect Peripheral Base Address
+ *
+ * Reads "soc/ranges" of the device tree. The first cell is the bus address
+ * of peripherals (0x7E000000) followed by the physical address, which is
+ * one cell on BCM2835/6/7 and two cells on BCM2711.
+ *
+ * @param [in]	dt_dir	path of device tree directory (NULL: "/proc/device-tree")
+ * @param [out]	base	address of physical base address of peripherals
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiRegmapDetectBase(const char *dt_dir, uint32_t *base)
+{
+	char path_str[D_LENGTH_PATH];
+	uint8_t ranges[12];
+	FILE *fp;
+	size_t size;
+
+	/* check parameter */
+	assert(base != NULL);
+
+	/* read ranges */
+	snprintf(path_str, sizeof(path_str), "%s/soc/ranges", (dt_dir != NULL) ? dt_dir : D_DIR_DEVICE_TREE);
+	if ((fp = fopen(path_str, "rb")) == NULL) {
+		return E_OBJ;
+	}
+	size = fread(ranges, 1, sizeof(ranges), fp);
+	fclose(fp);
+	if (size < 8) {
+		return E_OBJ;
+	}
+
+	/* one-cell physical address, or the lower cell of two-cell one */
+	*base = sRpiRegmapReadCell(&ranges[4]);
+	if ((*base == 0) && (size >= 12)) {
+		*base = sRpiRegmapReadCell(&ranges[8]);
+	}
+
+	return (*base != 0) ? E_OK : E_OBJ;
+}
+
+/**
+ * @brief Getter of Peripheral Base Address
+ *
+ * @param nothing
+ *
+ * @return physical base address of peripherals used by the register map
+ */
+uint32_t rpiRegmapGetBase()
+{
+	return g_regmap_base_peri;
+}
+
+/**
+ * @brief Getter of Mapped Blocks
+ *
+ * @param nothing
+ *
+ * @return bit mask of mapped blocks
+ *		@arg D_RPI_BLOCK_GPIO	GPIO
+ *		@arg D_RPI_BLOCK_CM		clock manager (not mapped via /dev/gpiomem)
+ */
+uint8_t rpiRegmapGetBlocks()
+{
+	uint8_t blocks = 0U;
+
+	if (M_CHECK_BASE_GPIO()) {
+		blocks |= D_RPI_BLOCK_GPIO;
+	}
+	if (M_CHECK_BASE_CM()) {
+		blocks |= D_RPI_BLOCK_CM;
+	}
+
+	return blocks;
+}
+
+/**
+ * @brief Enable/Disable Shadow Cache
+ *
+ * In D_RPI_SHADOW_ON mode, setters of configuration registers (GPFSEL, CM_GPnCTL and CM_GPnDIV)
+ * write them without reading back, and getters of their fields are served from the shadow cache.
+ * CM_GPnCTL.BUSY is always read from the register.
+ * The shadow cache is loaded from the registers when it is enabled,
+ * so registers must not be modified by other processes while it is enabled.
+ *
+ * @param [in]	mode	mode of shadow cache
+ *		@arg D_RPI_SHADOW_OFF		read registers for each access (default)
+ *		@arg D_RPI_SHADOW_ON		use shadow cache
+ *		@arg D_RPI_SHADOW_VALIDATE	read registers and compare them with shadow cache
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiRegmapShadowEnable(uint8_t mode)
+{
+	/* check parameter */
+	assert(M_CHECK_SHADOW(mode));
+
+	if (mode != D_RPI_SHADOW_OFF) {
+		if (rpiRegmapShadowResync() != E_OK) {
+			return E_OBJ;
 		}
+	}
+
+	g_regmap_shadow_mode = mode;
+
+	return E_OK;
+}
 
+/**
+ * @brief Load Shadow Cache from Registers
+ *
+ * @param nothing
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiRegmapShadowResync()
+{
+	volatile uint32_t *addr;
+	uint8_t slot;
+
+	if (!M_CHECK_BASE_GPIO() && !M_CHECK_BASE_CM()) {
+		fprintf(stderr, "rpiRegmap: registers are not mapped\n");
+		return E_OBJ;
+	}
+
+	for (slot = 0; slot < D_RPI_SLOT_NUM; slot++) {
+		addr = sRpiRegmapSlotAddr(slot);
+		g_regmap_shadow[slot] = (addr != NULL) ? (rpiRegmapRawRead(addr) & ~sRpiRegmapSlotIgnore(slot)) : 0U;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief Compare Shadow Cache with Registers
+ *
+ * Password fields and CM_GPnCTL.BUSY are not compared.
+ *
+ * @param [out]	mismatch	bit mask of mismatched slots (NULL: not used)
+ *
+ * @retval E_OK		shadow cache matches registers
+ * @retval E_OBJ	shadow cache does not match registers (or registers are not mapped)
+ */
+int8_t rpiRegmapShadowValidate(uint16_t *mismatch)
+{
+	volatile uint32_t *addr;
+	uint16_t bits = 0U;
+	uint8_t slot;
+
+	if (!M_CHECK_BASE_GPIO() && !M_CHECK_BASE_CM()) {
+		fprintf(stderr, "rpiRegmap: registers are not mapped\n");
+		return E_OBJ;
+	}
+
+	for (slot = 0; slot < D_RPI_SLOT_NUM; slot++) {
+		addr = sRpiRegmapSlotAddr(slot);
+		if ((addr != NULL) &&
+			(((rpiRegmapRawRead(addr) ^ g_regmap_shadow[slot]) & ~sRpiRegmapSlotIgnore(slot)) != 0U)) {
+			bits |= (uint16_t)(1U << slot);
+		}
+	}
+
+	if (mismatch != NULL) {
+		*mismatch = bits;
+	}
+
+	return (bits == 0U) ? E_OK : E_OBJ;
+}
+
+/**
+ * @brief Check Register Value with Shadow Cache (D_RPI_SHADOW_VALIDATE mode)
+ *
+ * On mismatch, reports it, counts it and updates the shadow cache by the register value.
+ *
+ * @param [in]	slot	slot of register
+ * @param [in]	val		value read from register
+ *
+ * @return nothing
+ */
+void rpiRegmapShadowCheck(uint8_t slot, uint32_t val)
+{
+	uint32_t ignore;
+
+	/* check parameter */
+	assert(M_CHECK_SLOT(slot));
+
+	ignore = sRpiRegmapSlotIgnore(slot);
+	if (((val ^ g_regmap_shadow[slot]) & ~ignore) != 0U) {
+		fprintf(stderr, "rpiRegmap: shadow mismatch (slot %u: register 0x%08X, shadow 0x%08X)\n",
+				slot, val, g_regmap_shadow[slot]);
+		g_regmap_shadow_errors++;
+		g_regmap_shadow[slot] = val & ~ignore;
+	}
+}
+
+/**
+ * @brief Getter of Number of Shadow Cache Mismatches
+ *
+ * @param nothing
+ *
+ * @return number of mismatches detected in D_RPI_SHADOW_VALIDATE mode
+ */
+uint32_t rpiRegmapShadowGetErrors()
+{
+	return g_regmap_shadow_errors;
+}
+
+/**
+ * @brief Enable/Disable Concurrency-Safe Mode
+ *
+ * In concurrency-safe mode, read-modify-write of each configuration register
+ * (GPFSEL, CM_GPnCTL and CM_GPnDIV) is serialized by a spinlock per register,
+ * so threads may configure pins sharing a GPFSEL register at the same time.
+ * GPSET/GPCLR are single stores, so they are never locked.
+ * Call this function while no other thread accesses the registers.
+ *
+ * @param [in]	enable	enable or not
+ *		@arg 0		disable (default)
+ *		@arg 1		enable
+ *
+ * @return nothing
+ */
+void rpiRegmapLockEnable(uint8_t enable)
+{
+	uint8_t slot;
+
+	for (slot = 0; slot < D_RPI_SLOT_NUM; slot++) {
+		__atomic_clear(&g_regmap_lock[slot], __ATOMIC_RELAXED);
+	}
+	__atomic_store_n(&g_regmap_lock_enabled, (enable != 0U), __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Begin Register Transaction
+ *
+ * Field updates are queued by rpiRegmapQueueXxx(txn, idx, val) after this function.
+ *
+ * @param [out]	txn		transaction
+ *
+ * @return nothing
+ */
+void rpiRegmapTxnBegin(T_RPI_REGMAP_TXN *txn)
+{
+	/* check parameter */
+	assert(txn != NULL);
+
+	memset(txn, 0, sizeof(*txn));
+}
+
+/**
+ * @brief Commit Register Transaction
+ *
+ * All queued fields of the same register are merged into one (password-stamped) store.
+ * Registers are written in the order of GPFSEL0-5, CM_GP0-2DIV and CM_GP0-2CTL,
+ * so that divisors are set before the clock source and MASH of their channels.
+ * Nothing is written if any of the registers is not mapped.
+ *
+ * @param [in]	txn		transaction
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiRegmapTxnCommit(const T_RPI_REGMAP_TXN *txn)
+{
+	volatile uint32_t *addr;
+	uint32_t ignore, upd;
+	uint8_t slot;
+
+	M_INSTRUMENT_FUNC(REGMAP_TXN_COMMIT);
+
+	/* check parameter */
+	assert(txn != NULL);
+
+	/* check mapping of all registers before writing */
+	for (slot = 0; slot < D_RPI_SLOT_NUM; slot++) {
+		if ((txn->mask[slot] != 0U) && (sRpiRegmapSlotAddr(slot) == NULL)) {
+			fprintf(stderr, "rpiRegmap: register of slot %u is not mapped\n", slot);
+			return E_OBJ;
+		}
+	}
+
+	/* write registers */
+	for (slot = 0; slot < D_RPI_SLOT_NUM; slot++) {
+		if (txn->mask[slot] == 0U) {
+			continue;
+		}
+		addr   = sRpiRegmapSlotAddr(slot);
+		ignore = sRpiRegmapSlotIgnore(slot);
+		M_INSTRUMENT_REG_WRITE(slot);
+		rpiRegmapLock(slot);
+		upd    = (txn->val[slot] & txn->mask[slot]) |
+				 (rpiRegmapShadowLoad(addr, slot) & ~(txn->mask[slot] | ignore));
+		rpiRegmapRawWrite(addr, upd | ((ignore != 0U) ? M_RPI_FIELD_PASSWD(D_RPI_CMGPCTL_PASSWD) : 0U));
+		rpiRegmapShadowStore(slot, upd);
+		rpiRegmapUnlock(slot);
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief Map Registers
+ *
+ * Maps clock manager and GPIO by one window of /dev/mem.
+ * If /dev/mem cannot be opened (e.g. no root privilege) or mapped
+ * (e.g. CONFIG_STRICT_DEVMEM, locked-down kernel),
+ * only GPIO is mapped via /dev/gpiomem.
+ *
+ * @param nothing
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiRegmapMap()
+{
+	int fd;
+	void *mmap_win;
+	uint32_t base;
+
+	/* detect peripheral base address (keep the default one if not found) */
+	if (rpiRegmapDetectBase(NULL, &base) == E_OK) {
+		g_regmap_base_peri = base;
+	}
+
+	if ((fd = open(D_DEV_MEM, O_RDWR | O_SYNC)) != -1) {
+		/* map clock manager - GPIO */
+		mmap_win = mmap(NULL, D_RPI_WINDOW_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+						fd, (off_t)g_regmap_base_peri + D_RPI_OFFSET_CM);
 		if (close(fd) == -1) {
 			perror("close");
-			ret = E_OBJ;
 		}
+		if (mmap_win != MAP_FAILED) {
+			g_regmap_base_cm   = (volatile uint8_t *)mmap_win;
+			g_regmap_base_gpio = (volatile uint8_t *)mmap_win + (D_RPI_OFFSET_GPIO - D_RPI_OFFSET_CM);
+			return E_OK;
+		}
+		perror("mmap");
 	}
 
-	return ret;
+	if ((fd = open(D_DEV_GPIOMEM, O_RDWR | O_SYNC)) == -1) {
+		perror("open");
+		return E_OBJ;
+	}
+
+	/* map GPIO only */
+	mmap_win = mmap(NULL, D_RPI_BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (close(fd) == -1) {
+		perror("close");
+	}
+	if (mmap_win == MAP_FAILED) {
+		perror("mmap");
+		return E_OBJ;
+	}
+	g_regmap_base_gpio = (volatile uint8_t *)mmap_win;
+
+	return E_OK;
 }
 
 /**
- * @brief Finalize Register Map
+ * @brief Map Simulated Registers
  *
- * @param nothing
+ * @param [in]	path	path of backing file (NULL: anonymous memory)
  *
  * @retval E_OK		success
  * @retval E_OBJ	failure (object error)
  */
-int8_t rpiRegmapFinal()
+static int8_t sRpiRegmapMapSim(const char *path)
 {
-	int8_t ret = E_OK;
+	int fd = -1;
+	struct stat st;
+	void *mmap_win;
+	int flags = MAP_SHARED;
 
-	/* unmap GPIO */
-	if (munmap((void *)g_regmap_base_gpio, D_RPI_BLOCK_SIZE) == -1) {
-		perror("munmap");
-		ret = E_OBJ;
+	if (path == NULL) {
+		flags |= MAP_ANONYMOUS;
 	} else {
-		g_regmap_base_gpio = NULL;
+		/* prepare backing file */
+		if ((fd = open(path, O_RDWR | O_CREAT, 0644)) == -1) {
+			perror("open");
+			return E_OBJ;
+		}
+		if ((fstat(fd, &st) == -1) ||
+			((st.st_size < D_RPI_WINDOW_SIZE) && (ftruncate(fd, D_RPI_WINDOW_SIZE) == -1))) {
+			perror("ftruncate");
+			close(fd);
+			return E_OBJ;
+		}
 	}
 
-	/* unmap clock manager */
-	if (munmap((void *)g_regmap_base_cm, D_RPI_BLOCK_SIZE) == -1) {
-		perror("munmap");
-		ret = E_OBJ;
+	/* map clock manager - GPIO (same layout as /dev/mem) */
+	if ((mmap_win = mmap(NULL, D_RPI_WINDOW_SIZE,
+						 PROT_READ | PROT_WRITE, flags, fd, 0)) == MAP_FAILED) {
+		perror("mmap");
+		if (fd != -1) {
+			close(fd);
+		}
+		return E_OBJ;
+	}
+	g_regmap_base_cm   = (volatile uint8_t *)mmap_win;
+	g_regmap_base_gpio = (volatile uint8_t *)mmap_win + (D_RPI_OFFSET_GPIO - D_RPI_OFFSET_CM);
+
+	if ((fd != -1) && (close(fd) == -1)) {
+		perror("close");
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief Read Device Tree Cell
+ *
+ * @param [in]	cell	address of cell (big endian)
+ *
+ * @return value of cell
+ */
+static uint32_t sRpiRegmapReadCell(const uint8_t *cell)
+{
+	return ((uint32_t)cell[0] << 24) | ((uint32_t)cell[1] << 16) |
+		   ((uint32_t)cell[2] <<  8) |  (uint32_t)cell[3];
+}
+
+/**
+ * @brief Address of Configuration Register
+ *
+ * @param [in]	slot	slot of register
+ *
+ * @return address of register (NULL: not mapped)
+ */
+static volatile uint32_t *sRpiRegmapSlotAddr(uint8_t slot)
+{
+	if (slot < M_RPI_SLOT_CMGPDIV(0)) {
+		return M_CHECK_BASE_GPIO() ? M_RPI_ADDR_GPFSEL(slot * 10) : NULL;
+	} else if (slot < M_RPI_SLOT_CMGPCTL(0)) {
+		return M_CHECK_BASE_CM() ? M_RPI_ADDR_CMGPDIV(slot - M_RPI_SLOT_CMGPDIV(0)) : NULL;
 	} else {
-		g_regmap_base_cm = NULL;
+		return M_CHECK_BASE_CM() ? M_RPI_ADDR_CMGPCTL(slot - M_RPI_SLOT_CMGPCTL(0)) : NULL;
 	}
+}
 
-	return ret;
+/**
+ * @brief Bits of Configuration Register not Kept in Shadow Cache
+ *
+ * @param [in]	slot	slot of register
+ *
+ * @return bit mask of password field and status bits
+ */
+static uint32_t sRpiRegmapSlotIgnore(uint8_t slot)
+{
+	if (slot < M_RPI_SLOT_CMGPDIV(0)) {
+		return 0U;
+	} else if (slot < M_RPI_SLOT_CMGPCTL(0)) {
+		return D_RPI_MASK_CMGPDIV_PASSWD;
+	} else {
+		return D_RPI_MASK_CMGPCTL_PASSWD | D_RPI_MASK_CMGPCTL_BUSY;
+	}
 }
 
 /**
@@ -152,16 +834,58 @@ int8_t rpiRegmapFinal()
  */
 void rpiRegmapSetGpfselFsel(uint8_t pin, uint32_t fsel)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_GPFSEL(pin);
-	uint8_t shamt = M_RPI_SHAMT_GPFSEL_FSEL(pin);
-	uint32_t mask = M_RPI_MASK_GPFSEL_FSEL(pin);
-
 	/* check parameter */
 	assert(M_CHECK_BASE_GPIO());
 	assert(M_CHECK_PIN(pin));
 
 	/* set FSEL */
-	*addr = ((fsel << shamt) & mask) | (*addr & ~mask);
+	rpiRegmapWriteGpfselFsel(pin, fsel);
+}
+
+/**
+ * @brief Setter of GPSETn
+ *
+ * Drives the pins whose bits are 1 in mask to high level by a single store.
+ * Pins whose bits are 0 are not affected, so no read-modify-write is needed.
+ *
+ * @param [in]	bank	bank of GPIO pin
+ *		@arg 0	GPSET0 (GPIO pin 0 - GPIO pin 31)
+ *		@arg 1	GPSET1 (GPIO pin 32 - GPIO pin 53)
+ * @param [in]	mask	bit mask of GPIO pins (refer to M_RPI_GPIO_BIT())
+ *
+ * @return nothing
+ */
+void rpiRegmapSetGpset(uint8_t bank, uint32_t mask)
+{
+	/* check parameter */
+	assert(M_CHECK_BASE_GPIO());
+	assert(M_CHECK_BANK(bank));
+
+	/* set pins */
+	rpiRegmapWriteGpset(bank, mask);
+}
+
+/**
+ * @brief Setter of GPCLRn
+ *
+ * Drives the pins whose bits are 1 in mask to low level by a single store.
+ * Pins whose bits are 0 are not affected, so no read-modify-write is needed.
+ *
+ * @param [in]	bank	bank of GPIO pin
+ *		@arg 0	GPCLR0 (GPIO pin 0 - GPIO pin 31)
+ *		@arg 1	GPCLR1 (GPIO pin 32 - GPIO pin 53)
+ * @param [in]	mask	bit mask of GPIO pins (refer to M_RPI_GPIO_BIT())
+ *
+ * @return nothing
+ */
+void rpiRegmapSetGpclr(uint8_t bank, uint32_t mask)
+{
+	/* check parameter */
+	assert(M_CHECK_BASE_GPIO());
+	assert(M_CHECK_BANK(bank));
+
+	/* clear pins */
+	rpiRegmapWriteGpclr(bank, mask);
 }
 
 /**
@@ -179,18 +903,13 @@ void rpiRegmapSetGpfselFsel(uint8_t pin, uint32_t fsel)
  */
 void rpiRegmapSetCmGpctlMash(uint8_t ch, uint32_t mash)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPCTL(ch);
-	uint32_t mask = D_RPI_MASK_CMGPCTL_PASSWD | D_RPI_MASK_CMGPCTL_MASH;
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 	assert(M_CHECK_CM_MASH(mash));
 
 	/* set MASH */
-	*addr = ((((uint32_t)D_RPI_CMGPCTL_PASSWD << D_RPI_SHAMT_CMGPCTL_PASSWD) |
-			  (mash                           << D_RPI_SHAMT_CMGPCTL_MASH)) &  mask) |
-			(*addr                                                          & ~mask);
+	rpiRegmapWriteCmGpctlMash(ch, mash);
 }
 
 /**
@@ -206,18 +925,13 @@ void rpiRegmapSetCmGpctlMash(uint8_t ch, uint32_t mash)
  */
 void rpiRegmapSetCmGpctlEnab(uint8_t ch, uint32_t enab)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPCTL(ch);
-	uint32_t mask = D_RPI_MASK_CMGPCTL_PASSWD | D_RPI_MASK_CMGPCTL_ENAB;
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 	assert(M_CHECK_CM_ENAB(enab));
 
 	/* set ENAB */
-	*addr = ((((uint32_t)D_RPI_CMGPCTL_PASSWD << D_RPI_SHAMT_CMGPCTL_PASSWD) |
-			  (enab                           << D_RPI_SHAMT_CMGPCTL_ENAB)) &  mask) |
-			(*addr                                                          & ~mask);
+	rpiRegmapWriteCmGpctlEnab(ch, enab);
 }
 
 /**
@@ -239,18 +953,13 @@ void rpiRegmapSetCmGpctlEnab(uint8_t ch, uint32_t enab)
  */
 void rpiRegmapSetCmGpctlSrc(uint8_t ch, uint32_t src)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPCTL(ch);
-	uint32_t mask = D_RPI_MASK_CMGPCTL_PASSWD | D_RPI_MASK_CMGPCTL_SRC;
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 	assert(M_CHECK_CM_SRC(src));
 
 	/* set SRC */
-	*addr = ((((uint32_t)D_RPI_CMGPCTL_PASSWD << D_RPI_SHAMT_CMGPCTL_PASSWD) |
-			  (src                            << D_RPI_SHAMT_CMGPCTL_SRC)) &  mask) |
-			(*addr                                                         & ~mask);
+	rpiRegmapWriteCmGpctlSrc(ch, src);
 }
 
 /**
@@ -264,17 +973,12 @@ void rpiRegmapSetCmGpctlSrc(uint8_t ch, uint32_t src)
  */
 void rpiRegmapSetCmGpdivDivi(uint8_t ch, uint32_t divi)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPDIV(ch);
-	uint32_t mask = D_RPI_MASK_CMGPDIV_PASSWD | D_RPI_MASK_CMGPDIV_DIVI;
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 
 	/* set DIVI */
-	*addr = ((((uint32_t)D_RPI_CMGPDIV_PASSWD << D_RPI_SHAMT_CMGPDIV_PASSWD) |
-			  (divi                           << D_RPI_SHAMT_CMGPDIV_DIVI)) &  mask) |
-			(*addr                                                          & ~mask);
+	rpiRegmapWriteCmGpdivDivi(ch, divi);
 }
 
 /**
@@ -288,17 +992,12 @@ void rpiRegmapSetCmGpdivDivi(uint8_t ch, uint32_t divi)
  */
 void rpiRegmapSetCmGpdivDivf(uint8_t ch, uint32_t divf)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPDIV(ch);
-	uint32_t mask = D_RPI_MASK_CMGPDIV_PASSWD | D_RPI_MASK_CMGPDIV_DIVF;
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 
 	/* set DIVF */
-	*addr = ((((uint32_t)D_RPI_CMGPDIV_PASSWD << D_RPI_SHAMT_CMGPDIV_PASSWD) |
-			  (divf                           << D_RPI_SHAMT_CMGPDIV_DIVF)) &  mask) |
-			(*addr                                                          & ~mask);
+	rpiRegmapWriteCmGpdivDivf(ch, divf);
 }
 
 /**
@@ -318,14 +1017,54 @@ void rpiRegmapSetCmGpdivDivf(uint8_t ch, uint32_t divf)
  */
 uint32_t rpiRegmapGetGpfselFsel(uint8_t pin)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_GPFSEL(pin);
-
 	/* check parameter */
 	assert(M_CHECK_BASE_GPIO());
 	assert(M_CHECK_PIN(pin));
 
 	/* get FSEL */
-	return (*addr & M_RPI_MASK_GPFSEL_FSEL(pin)) >> M_RPI_SHAMT_GPFSEL_FSEL(pin);
+	return rpiRegmapReadGpfselFsel(pin);
+}
+
+/**
+ * @brief Getter of GPLEVn
+ *
+ * @param [in]	bank	bank of GPIO pin
+ *		@arg 0	GPLEV0 (GPIO pin 0 - GPIO pin 31)
+ *		@arg 1	GPLEV1 (GPIO pin 32 - GPIO pin 53)
+ *
+ * @return levels of GPIO pins (bit n: level of GPIO pin (32 * bank + n))
+ */
+uint32_t rpiRegmapGetGplev(uint8_t bank)
+{
+	/* check parameter */
+	assert(M_CHECK_BASE_GPIO());
+	assert(M_CHECK_BANK(bank));
+
+	/* get levels */
+	return rpiRegmapReadGplev(bank);
+}
+
+/**
+ * @brief Getter of GPLEV0 and GPLEV1
+ *
+ * The two words are read back-to-back, not atomically.
+ *
+ * @param nothing
+ *
+ * @return levels of GPIO pins (bit n: level of GPIO pin n)
+ */
+uint64_t rpiRegmapGetGplevAll()
+{
+	uint32_t lev0, lev1;
+
+	/* check parameter */
+	assert(M_CHECK_BASE_GPIO());
+
+	/* get levels */
+	lev0 = rpiRegmapReadGplev(0);
+	lev1 = rpiRegmapReadGplev(1);
+
+	return ((uint64_t)lev1 << 32) | lev0;
 }
 
 /**
@@ -341,14 +1080,12 @@ uint32_t rpiRegmapGetGpfselFsel(uint8_t pin)
  */
 uint32_t rpiRegmapGetCmGpctlMash(uint8_t ch)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPCTL(ch);
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 
 	/* get MASH */
-	return (*addr & D_RPI_MASK_CMGPCTL_MASH) >> D_RPI_SHAMT_CMGPCTL_MASH;
+	return rpiRegmapReadCmGpctlMash(ch);
 }
 
 /**
@@ -362,14 +1099,12 @@ uint32_t rpiRegmapGetCmGpctlMash(uint8_t ch)
  */
 uint32_t rpiRegmapGetCmGpctlBusy(uint8_t ch)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPCTL(ch);
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 
 	/* get BUSY */
-	return (*addr & D_RPI_MASK_CMGPCTL_BUSY) >> D_RPI_SHAMT_CMGPCTL_BUSY;
+	return rpiRegmapReadCmGpctlBusy(ch);
 }
 
 /**
@@ -383,14 +1118,12 @@ uint32_t rpiRegmapGetCmGpctlBusy(uint8_t ch)
  */
 uint32_t rpiRegmapGetCmGpctlEnab(uint8_t ch)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPCTL(ch);
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 
 	/* get ENAB */
-	return (*addr & D_RPI_MASK_CMGPCTL_ENAB) >> D_RPI_SHAMT_CMGPCTL_ENAB;
+	return rpiRegmapReadCmGpctlEnab(ch);
 }
 
 /**
@@ -410,14 +1143,12 @@ uint32_t rpiRegmapGetCmGpctlEnab(uint8_t ch)
  */
 uint32_t rpiRegmapGetCmGpctlSrc(uint8_t ch)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPCTL(ch);
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 
 	/* get SRC */
-	return (*addr & D_RPI_MASK_CMGPCTL_SRC) >> D_RPI_SHAMT_CMGPCTL_SRC;
+	return rpiRegmapReadCmGpctlSrc(ch);
 }
 
 /**
@@ -430,14 +1161,12 @@ uint32_t rpiRegmapGetCmGpctlSrc(uint8_t ch)
  */
 uint32_t rpiRegmapGetCmGpdivDivi(uint8_t ch)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPDIV(ch);
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 
 	/* get DIVI */
-	return (*addr & D_RPI_MASK_CMGPDIV_DIVI) >> D_RPI_SHAMT_CMGPDIV_DIVI;
+	return rpiRegmapReadCmGpdivDivi(ch);
 }
 
 /**
@@ -450,12 +1179,10 @@ uint32_t rpiRegmapGetCmGpdivDivi(uint8_t ch)
  */
 uint32_t rpiRegmapGetCmGpdivDivf(uint8_t ch)
 {
-	volatile uint32_t *addr = M_RPI_ADDR_CMGPDIV(ch);
-
 	/* check parameter */
 	assert(M_CHECK_BASE_CM());
 	assert(M_CHECK_CM_CH(ch));
 
 	/* get DIVF */
-	return (*addr & D_RPI_MASK_CMGPDIV_DIVF) >> D_RPI_SHAMT_CMGPDIV_DIVF;
+	return rpiRegmapReadCmGpdivDivf(ch);
 }
@@ -13,83 +13,817 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <assert.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
 #include "rpi_spi.h"
+#include "rpi_instrument.h"
 
 /*------------------------------------------------------------------------------
 	Defined Macros
 ------------------------------------------------------------------------------*/
 #define D_FD_NOT_OPENED			(-1)		/**< file descriptor (not opened) */
+#define D_SPI_BUFSIZ			(4096)		/**< maximum bytes of a message (default bufsiz of spidev) */
+#define D_SPI_BUFSIZ_PATH		"/sys/module/spidev/parameters/bufsiz"		/**< bufsiz parameter of spidev */
+
+/**
+ * alignment of each transfer in bounce buffers of spidev (ARCH_KMALLOC_MINALIGN,
+ * 64 on 32-bit ARM, 128 is a margin for arm64)
+ */
+#define D_SPI_ALIGN				(128)
+
+/** bytes of transfer counted against bufsiz by spidev */
+#define M_SPI_ALIGN(len)		(((len) + D_SPI_ALIGN - 1U) & ~(D_SPI_ALIGN - 1U))
+
+#define D_SPI_ASYNC_MERGE		(64)		/**< maximum number of requests merged into a message */
+#define D_SPI_POOL_NUM			(16)		/**< number of buffers in pool (up to 32) */
+
+/** maximum number of transfers in a message (size of SPI_IOC_MESSAGE() is limited by _IOC_SIZEBITS) */
+#define D_SPI_MSG_MAX			(((1 << _IOC_SIZEBITS) - 1) / sizeof(struct spi_ioc_transfer))
 
 /** check SPI mode */
 #define M_CHECK_MODE(mode) \
 	((mode == SPI_MODE_0) || (mode == SPI_MODE_1) || (mode == SPI_MODE_2) || (mode == SPI_MODE_3))
 
-/*------------------------------------------------------------------------------
-	Global Variables
-------------------------------------------------------------------------------*/
-static int		g_spi_fd			= D_FD_NOT_OPENED;	/**< file descriptor */
-static uint8_t	g_spi_mode			= SPI_MODE_0;		/**< SPI mode */
-static uint32_t	g_spi_speed			= 1000000UL;		/**< transfer speed */
-static uint16_t	g_spi_delay			= 0U;				/**< transfer delay time */
-static uint8_t	g_spi_bits_per_word	= 8U;				/**< bits per word */
-static uint8_t	g_spi_cs_polarity	= 0U;				/**< CS polarity */
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief request of asynchronous transfer (cell of queue) */
+typedef struct t_spi_request {
+	uint32_t		seq;		/**< sequence number of cell */
+	T_SPI_SEGMENT	seg;		/**< segment */
+	T_SPI_CALLBACK	callback;	/**< completion callback (NULL: not used) */
+	void			*arg;		/**< argument of callback */
+} T_SPI_REQUEST;
+
+/** @brief asynchronous transfer context (bounded multi-producer single-consumer queue and worker) */
+typedef struct t_spi_async {
+	T_SPI_REQUEST	*cells;		/**< cells of queue */
+	uint32_t		mask;		/**< number of cells - 1 (power of 2) */
+	uint32_t		head;		/**< enqueue position (shared by producers) */
+	uint32_t		tail;		/**< dequeue position (worker only) */
+	sem_t			pending;	/**< number of queued requests */
+	int				efd;		/**< eventfd (counts completed requests) */
+	pthread_t		thread;		/**< worker thread */
+} T_SPI_ASYNC;
+
+/** @brief SPI device handle */
+struct t_spi_dev {
+	int					fd;				/**< file descriptor */
+	pthread_mutex_t		lock;			/**< lock of handle (held during operations) */
+	T_SPI_PROFILE		conf;			/**< active settings */
+	T_SPI_PROFILE		hw;				/**< settings applied to spidev (mode, speed, bits per word, CS polarity) */
+	uint8_t				hw_valid;		/**< hw is valid (1) or not (0: all of them are applied) */
+	T_SPI_PROFILE		profiles[D_SPI_PROFILE_NUM];					/**< profiles */
+	char				profile_name[D_SPI_PROFILE_NUM][D_SPI_PROFILE_NAME];	/**< names of profiles */
+	uint8_t				profile_num;	/**< number of profiles */
+	uint32_t			bufsiz;			/**< maximum bytes of a message (bufsiz of spidev) */
+	T_SPI_ASYNC			*async;			/**< asynchronous transfer context (NULL: not started) */
+	uint8_t				*pool;			/**< buffer pool (D_SPI_POOL_NUM buffers) */
+	uint32_t			pool_size;		/**< size of each buffer (bufsiz rounded up to page size) */
+	uint32_t			pool_map;		/**< bitmap of acquired buffers */
+};
+
+/*------------------------------------------------------------------------------
+	Prototype Declaration
+------------------------------------------------------------------------------*/
+static int8_t sRpiSpiOpen(T_SPI_DEV *dev, uint8_t *dev_path);
+static int8_t sRpiSpiClose(T_SPI_DEV *dev);
+static int8_t sRpiSpiApply(T_SPI_DEV *dev);
+static int8_t sRpiSpiTransferSegs(T_SPI_DEV *dev, const T_SPI_SEGMENT *segs, uint32_t num);
+static int8_t sRpiSpiSubmit(T_SPI_DEV *dev, struct spi_ioc_transfer *xfer, uint32_t num);
+static uint32_t sRpiSpiReadBufsiz();
+static void *sRpiSpiWorker(void *arg);
+static uint8_t sRpiSpiDequeue(T_SPI_ASYNC *async, T_SPI_REQUEST *req);
+
+/*------------------------------------------------------------------------------
+	Global Variables
+------------------------------------------------------------------------------*/
+/** default settings of handle */
+#define M_SPI_DEV_DEFAULT \
+	.fd            = D_FD_NOT_OPENED, \
+	.conf          = {SPI_MODE_0, 1000000UL, 0U, 8U, D_SPI_CS_NEG_LOGIC}, \
+	.bufsiz        = D_SPI_BUFSIZ
+
+/** default handle (used by the functions without handle) */
+static T_SPI_DEV g_spi_dev = {M_SPI_DEV_DEFAULT, .lock = PTHREAD_MUTEX_INITIALIZER};
+
+/*------------------------------------------------------------------------------
+	Functions (External)
+------------------------------------------------------------------------------*/
+/**
+ * @brief SPI Port Open (default handle)
+ *
+ * @param [in]	dev_path	string of path for device node (e.g. "/dev/spidev0.0")
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiOpen(uint8_t *dev_path)
+{
+	int8_t ret;
+
+	/* check parameter */
+	assert(dev_path != NULL);
+
+	pthread_mutex_lock(&g_spi_dev.lock);
+
+	/* check port */
+	assert(g_spi_dev.fd == D_FD_NOT_OPENED);
+
+	ret = sRpiSpiOpen(&g_spi_dev, dev_path);
+
+	pthread_mutex_unlock(&g_spi_dev.lock);
+
+	return ret;
+}
+
+/**
+ * @brief SPI Port Close (default handle)
+ *
+ * @param Nothing
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiClose()
+{
+	int8_t ret;
+
+	/* stop asynchronous transfer */
+	rpiSpiDevAsyncStop(&g_spi_dev);
+
+	pthread_mutex_lock(&g_spi_dev.lock);
+
+	/* check port */
+	assert(g_spi_dev.fd != D_FD_NOT_OPENED);
+
+	ret = sRpiSpiClose(&g_spi_dev);
+
+	pthread_mutex_unlock(&g_spi_dev.lock);
+
+	return ret;
+}
+
+/**
+ * @brief SPI Data Transfer (default handle)
+ *
+ * @param [in]	tx_data		address of write data buffer (NULL: read only)
+ * @param [out]	rx_data		address of read data buffer (NULL: write only)
+ * @param [in]	size		buffer size
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiTransfer(uint8_t *tx_data, uint8_t *rx_data, uint32_t size)
+{
+	return rpiSpiDevTransfer(&g_spi_dev, tx_data, rx_data, size);
+}
+
+/**
+ * @brief SPI Data Write (default handle, write only)
+ *
+ * @param [in]	tx_data		address of write data buffer
+ * @param [in]	size		buffer size
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiWrite(uint8_t *tx_data, uint32_t size)
+{
+	return rpiSpiDevWrite(&g_spi_dev, tx_data, size);
+}
+
+/**
+ * @brief SPI Data Read (default handle, read only)
+ *
+ * @param [out]	rx_data		address of read data buffer
+ * @param [in]	size		buffer size
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiRead(uint8_t *rx_data, uint32_t size)
+{
+	return rpiSpiDevRead(&g_spi_dev, rx_data, size);
+}
+
+/**
+ * @brief SPI Batched Data Transfer (default handle)
+ *
+ * @param [in]	segs	segments
+ * @param [in]	num		number of segments
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiTransferBatch(const T_SPI_SEGMENT *segs, uint32_t num)
+{
+	return rpiSpiDevTransferBatch(&g_spi_dev, segs, num);
+}
+
+/**
+ * @brief SPI Mode Setting (default handle)
+ *
+ * @param [in]	mode	SPI mode
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiSetMode(uint8_t mode)
+{
+	return rpiSpiDevSetMode(&g_spi_dev, mode);
+}
+
+/**
+ * @brief SPI Transfer Speed Setting (default handle)
+ *
+ * @param [in]	speed	transfer speed
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiSetSpeed(uint32_t speed)
+{
+	return rpiSpiDevSetSpeed(&g_spi_dev, speed);
+}
+
+/**
+ * @brief SPI Transfer Delay Time Setting (default handle)
+ *
+ * @param [in]	delay	transfer delay time (usec)
+ *
+ * @retval E_OK		success
+ */
+int8_t rpiSpiSetDelay(uint16_t delay)
+{
+	return rpiSpiDevSetDelay(&g_spi_dev, delay);
+}
+
+/**
+ * @brief SPI Bits per Word Setting (default handle)
+ *
+ * @param [in]	len		bit length per a word
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiSetBitsPerWord(uint8_t len)
+{
+	return rpiSpiDevSetBitsPerWord(&g_spi_dev, len);
+}
+
+/**
+ * @brief SPI CS Polarity Setting (default handle)
+ *
+ * @param [in]	pol		CS polarity
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiSetCsPolarity(uint8_t pol)
+{
+	return rpiSpiDevSetCsPolarity(&g_spi_dev, pol);
+}
+
+/**
+ * @brief Acquire Buffer from Pool (default handle)
+ *
+ * @param [out]	buf		address of buffer
+ * @param [out]	size	size of buffer (NULL: not used)
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (all buffers are acquired)
+ */
+int8_t rpiSpiBufAcquire(uint8_t **buf, uint32_t *size)
+{
+	return rpiSpiDevBufAcquire(&g_spi_dev, buf, size);
+}
+
+/**
+ * @brief Add Configuration Profile (default handle)
+ *
+ * @param [in]	name		name of profile
+ * @param [in]	profile		settings
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (parameter error)
+ * @retval E_OBJ	failure (no more profiles can be added)
+ */
+int8_t rpiSpiProfileAdd(const char *name, const T_SPI_PROFILE *profile)
+{
+	return rpiSpiDevProfileAdd(&g_spi_dev, name, profile);
+}
+
+/**
+ * @brief Select Configuration Profile (default handle)
+ *
+ * @param [in]	name		name of profile
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (parameter error)
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiProfileSelect(const char *name)
+{
+	return rpiSpiDevProfileSelect(&g_spi_dev, name);
+}
+
+/**
+ * @brief Release Buffer to Pool (default handle)
+ *
+ * @param [in]	buf		address of buffer (acquired by rpiSpiBufAcquire())
+ *
+ * @retval E_OK		success
+ */
+int8_t rpiSpiBufRelease(uint8_t *buf)
+{
+	return rpiSpiDevBufRelease(&g_spi_dev, buf);
+}
+
+/**
+ * @brief SPI Port Open (new handle)
+ *
+ * Each handle has its own file descriptor and settings, and operations on a handle
+ * are serialized by its lock, so different devices can be used from different threads in parallel.
+ *
+ * @param [in]	dev_path	string of path for device node (e.g. "/dev/spidev0.0")
+ * @param [out]	dev			SPI device handle
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevOpen(uint8_t *dev_path, T_SPI_DEV **dev)
+{
+	T_SPI_DEV *new_dev;
+
+	/* check parameter */
+	assert(dev_path != NULL);
+	assert(dev != NULL);
+
+	if ((new_dev = malloc(sizeof(T_SPI_DEV))) == NULL) {
+		perror("malloc");
+		return E_OBJ;
+	}
+	*new_dev = (T_SPI_DEV){M_SPI_DEV_DEFAULT};
+	pthread_mutex_init(&new_dev->lock, NULL);
+
+	if (sRpiSpiOpen(new_dev, dev_path) != E_OK) {
+		pthread_mutex_destroy(&new_dev->lock);
+		free(new_dev);
+		return E_OBJ;
+	}
+
+	*dev = new_dev;
+
+	return E_OK;
+}
+
+/**
+ * @brief SPI Port Close (handle)
+ *
+ * Queued asynchronous transfers are completed before closing.
+ * The handle is released even if close() fails.
+ *
+ * @param [in]	dev		SPI device handle
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevClose(T_SPI_DEV *dev)
+{
+	int8_t ret;
+
+	/* check parameter */
+	assert(dev != NULL);
+	assert(dev != &g_spi_dev);
+
+	/* stop asynchronous transfer */
+	rpiSpiDevAsyncStop(dev);
+
+	pthread_mutex_lock(&dev->lock);
+	ret = sRpiSpiClose(dev);
+	pthread_mutex_unlock(&dev->lock);
+
+	pthread_mutex_destroy(&dev->lock);
+	free(dev);
+
+	return ret;
+}
+
+/**
+ * @brief SPI Data Transfer (handle)
+ *
+ * Either of the buffers can be NULL for half-duplex transfer
+ * (spidev sends zeros if tx_data is NULL, and discards read data if rx_data is NULL).
+ *
+ * @param [in]	dev			SPI device handle
+ * @param [in]	tx_data		address of write data buffer (NULL: read only)
+ * @param [out]	rx_data		address of read data buffer (NULL: write only)
+ * @param [in]	size		buffer size
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevTransfer(T_SPI_DEV *dev, uint8_t *tx_data, uint8_t *rx_data, uint32_t size)
+{
+	T_SPI_SEGMENT seg;
+	int8_t ret;
+
+	M_INSTRUMENT_FUNC(SPI_TRANSFER);
+
+	/* check parameter */
+	assert(dev != NULL);
+	assert((tx_data != NULL) || (rx_data != NULL));
+	assert(size > 0);
+
+	pthread_mutex_lock(&dev->lock);
+
+	seg.tx        = tx_data;
+	seg.rx        = rx_data;
+	seg.len       = size;
+	seg.speed     = dev->conf.speed;
+	seg.delay     = dev->conf.delay;
+	seg.bits      = dev->conf.bits_per_word;
+	seg.cs_change = 0U;
+
+	/* transfer data (split by bufsiz of spidev) */
+	ret = sRpiSpiTransferSegs(dev, &seg, 1);
+
+	pthread_mutex_unlock(&dev->lock);
+
+	return ret;
+}
+
+/**
+ * @brief SPI Data Write (handle, write only)
+ *
+ * @param [in]	dev			SPI device handle
+ * @param [in]	tx_data		address of write data buffer
+ * @param [in]	size		buffer size
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevWrite(T_SPI_DEV *dev, uint8_t *tx_data, uint32_t size)
+{
+	/* check parameter */
+	assert(tx_data != NULL);
+
+	return rpiSpiDevTransfer(dev, tx_data, NULL, size);
+}
+
+/**
+ * @brief SPI Data Read (handle, read only, zeros are written)
+ *
+ * @param [in]	dev			SPI device handle
+ * @param [out]	rx_data		address of read data buffer
+ * @param [in]	size		buffer size
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevRead(T_SPI_DEV *dev, uint8_t *rx_data, uint32_t size)
+{
+	/* check parameter */
+	assert(rx_data != NULL);
+
+	return rpiSpiDevTransfer(dev, NULL, rx_data, size);
+}
+
+/**
+ * @brief SPI Batched Data Transfer (handle)
+ *
+ * Transfers the segments as one message (one ioctl), so CS is kept asserted between
+ * them unless cs_change of a segment is set.
+ * If the segments exceed the limits of spidev (number of transfers, or bufsiz bytes
+ * for each direction), they are split into several messages (and segments larger than bufsiz
+ * into several transfers). CS is kept asserted between the messages as well.
+ *
+ * @param [in]	dev		SPI device handle
+ * @param [in]	segs	segments
+ * @param [in]	num		number of segments
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevTransferBatch(T_SPI_DEV *dev, const T_SPI_SEGMENT *segs, uint32_t num)
+{
+	uint32_t i;
+	int8_t ret;
+
+	M_INSTRUMENT_FUNC(SPI_TRANSFER_BATCH);
+
+	/* check parameter */
+	assert(dev != NULL);
+	assert(segs != NULL);
+	assert(num > 0);
+	for (i = 0; i < num; i++) {
+		assert((segs[i].tx != NULL) || (segs[i].rx != NULL));
+		assert(segs[i].len > 0);
+	}
+
+	pthread_mutex_lock(&dev->lock);
+	ret = sRpiSpiTransferSegs(dev, segs, num);
+	pthread_mutex_unlock(&dev->lock);
+
+	return ret;
+}
+
+/**
+ * @brief SPI Mode Setting (handle)
+ *
+ * Settings are applied to spidev only if they differ from the applied ones
+ * (if the port is not opened, they are applied at open).
+ *
+ * @param [in]	dev		SPI device handle
+ * @param [in]	mode	SPI mode
+ *		@arg SPI_MODE_0		CPOL: positive logic, CPHA: positive edge
+ *		@arg SPI_MODE_1		CPOL: positive logic, CPHA: negative edge
+ *		@arg SPI_MODE_2		CPOL: negative logic, CPHA: positive edge
+ *		@arg SPI_MODE_3		CPOL: negative logic, CPHA: negative edge
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevSetMode(T_SPI_DEV *dev, uint8_t mode)
+{
+	int8_t ret;
+
+	M_INSTRUMENT_FUNC(SPI_SET_MODE);
+
+	/* check parameter */
+	assert(dev != NULL);
+	assert(M_CHECK_MODE(mode));
+
+	pthread_mutex_lock(&dev->lock);
+	dev->conf.mode = mode;
+	ret = sRpiSpiApply(dev);
+	pthread_mutex_unlock(&dev->lock);
+
+	return ret;
+}
+
+/**
+ * @brief SPI Transfer Speed Setting (handle)
+ *
+ * @param [in]	dev		SPI device handle
+ * @param [in]	speed	transfer speed
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevSetSpeed(T_SPI_DEV *dev, uint32_t speed)
+{
+	int8_t ret;
+
+	/* check parameter */
+	assert(dev != NULL);
+
+	pthread_mutex_lock(&dev->lock);
+	dev->conf.speed = speed;
+	ret = sRpiSpiApply(dev);
+	pthread_mutex_unlock(&dev->lock);
+
+	return ret;
+}
+
+/**
+ * @brief SPI Transfer Delay Time Setting (handle)
+ *
+ * @param [in]	dev		SPI device handle
+ * @param [in]	delay	transfer delay time (usec)
+ *
+ * @retval E_OK		success
+ */
+int8_t rpiSpiDevSetDelay(T_SPI_DEV *dev, uint16_t delay)
+{
+	/* check parameter */
+	assert(dev != NULL);
+
+	pthread_mutex_lock(&dev->lock);
+	dev->conf.delay = delay;
+	pthread_mutex_unlock(&dev->lock);
+
+	return E_OK;
+}
 
-/*------------------------------------------------------------------------------
-	Functions
-------------------------------------------------------------------------------*/
 /**
- * @brief SPI Port Open
+ * @brief SPI Bits per Word Setting (handle)
  *
- * @param [in]	dev_path	string of path for device node (e.g. "/dev/spidev0.0")
+ * @param [in]	dev		SPI device handle
+ * @param [in]	len		bit length per a word
  *
  * @retval E_OK		success
  * @retval E_OBJ	failure (object error)
  */
-int8_t rpiSpiOpen(uint8_t *dev_path)
+int8_t rpiSpiDevSetBitsPerWord(T_SPI_DEV *dev, uint8_t len)
 {
+	int8_t ret;
+
 	/* check parameter */
-	assert(dev_path != NULL);
+	assert(dev != NULL);
 
-	/* check port */
-	assert(g_spi_fd == D_FD_NOT_OPENED);
+	pthread_mutex_lock(&dev->lock);
+	dev->conf.bits_per_word = len;
+	ret = sRpiSpiApply(dev);
+	pthread_mutex_unlock(&dev->lock);
 
-	/* open SPI port */
-	if ((g_spi_fd = open((const char *)dev_path, O_RDWR)) == -1) {
-		perror("open");
-		return E_OBJ;
+	return ret;
+}
+
+/**
+ * @brief SPI CS Polarity Setting (handle)
+ *
+ * @param [in]	dev		SPI device handle
+ * @param [in]	pol		CS polarity
+ *		@arg D_SPI_CS_POS_LOGIC		positive logic
+ *		@arg D_SPI_CS_NEG_LOGIC		negative logic
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevSetCsPolarity(T_SPI_DEV *dev, uint8_t pol)
+{
+	int8_t ret;
+
+	/* check parameter */
+	assert(dev != NULL);
+
+	pthread_mutex_lock(&dev->lock);
+	dev->conf.cs_polarity = pol;
+	ret = sRpiSpiApply(dev);
+	pthread_mutex_unlock(&dev->lock);
+
+	return ret;
+}
+
+/**
+ * @brief Add Configuration Profile (handle)
+ *
+ * A profile of the same name is overwritten.
+ *
+ * @param [in]	dev			SPI device handle
+ * @param [in]	name		name of profile (shorter than D_SPI_PROFILE_NAME)
+ * @param [in]	profile		settings
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (parameter error)
+ * @retval E_OBJ	failure (no more profiles can be added)
+ */
+int8_t rpiSpiDevProfileAdd(T_SPI_DEV *dev, const char *name, const T_SPI_PROFILE *profile)
+{
+	uint8_t i;
+
+	/* check parameter */
+	assert(dev != NULL);
+	assert(name != NULL);
+	assert(profile != NULL);
+	if ((strlen(name) >= D_SPI_PROFILE_NAME) || !M_CHECK_MODE(profile->mode)) {
+		return E_PAR;
 	}
 
-	/* set default SPI mode */
-	if (rpiSpiSetMode(g_spi_mode) != E_OK) {
-		fprintf(stderr, "rpiSpiSetMode failed\n");
+	pthread_mutex_lock(&dev->lock);
+
+	for (i = 0; i < dev->profile_num; i++) {
+		if (strcmp(dev->profile_name[i], name) == 0) {
+			break;
+		}
+	}
+	if (i == D_SPI_PROFILE_NUM) {
+		pthread_mutex_unlock(&dev->lock);
+		fprintf(stderr, "too many profiles\n");
 		return E_OBJ;
 	}
+	if (i == dev->profile_num) {
+		strcpy(dev->profile_name[i], name);
+		dev->profile_num++;
+	}
+	dev->profiles[i] = *profile;
+
+	pthread_mutex_unlock(&dev->lock);
+
+	return E_OK;
+}
+
+/**
+ * @brief Select Configuration Profile (handle)
+ *
+ * The settings of the profile become the active settings (used by the following transfers).
+ * Only the settings which differ from the applied ones are issued to spidev,
+ * so switching between profiles of the same mode and bits per word costs only a speed ioctl or nothing.
+ *
+ * @param [in]	dev			SPI device handle
+ * @param [in]	name		name of profile
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (parameter error)
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevProfileSelect(T_SPI_DEV *dev, const char *name)
+{
+	uint8_t i;
+	int8_t ret;
+
+	M_INSTRUMENT_FUNC(SPI_PROFILE_SELECT);
+
+	/* check parameter */
+	assert(dev != NULL);
+	assert(name != NULL);
+
+	pthread_mutex_lock(&dev->lock);
+
+	for (i = 0; i < dev->profile_num; i++) {
+		if (strcmp(dev->profile_name[i], name) == 0) {
+			break;
+		}
+	}
+	if (i == dev->profile_num) {
+		pthread_mutex_unlock(&dev->lock);
+		return E_PAR;
+	}
+
+	dev->conf = dev->profiles[i];
+	ret = sRpiSpiApply(dev);
+
+	pthread_mutex_unlock(&dev->lock);
+
+	return ret;
+}
+
+/**
+ * @brief Start Asynchronous Transfer
+ *
+ * Starts a worker thread, which transfers the requests queued by rpiSpiDevSubmit().
+ * Requests queued while a message is in progress are merged into the next message
+ * (one ioctl), so the bus is kept busy as long as requests are queued in time.
+ *
+ * @param [in]	dev		SPI device handle
+ * @param [in]	depth	number of requests which can be queued (rounded up to power of 2)
+ *
+ * @retval E_OK		success
+ * @retval E_PAR	failure (parameter error)
+ * @retval E_OBJ	failure (object error)
+ */
+int8_t rpiSpiDevAsyncStart(T_SPI_DEV *dev, uint32_t depth)
+{
+	T_SPI_ASYNC *async;
+	uint32_t num, i;
+	int ret;
+
+	/* check parameter */
+	assert(dev != NULL);
+	if ((depth == 0U) || (depth > 0x80000000U)) {
+		return E_PAR;
+	}
 
-	/* set default transfer speed */
-	if (rpiSpiSetSpeed(g_spi_speed) != E_OK) {
-		fprintf(stderr, "rpiSpiSetSpeed failed\n");
+	if (dev->async != NULL) {
+		fprintf(stderr, "asynchronous transfer is running\n");
 		return E_OBJ;
 	}
 
-	/* set default transfer delay time */
-	if (rpiSpiSetDelay(g_spi_delay) != E_OK) {
-		fprintf(stderr, "rpiSpiSetDelay failed\n");
+	for (num = 1U; num < depth; num <<= 1);
+
+	if ((async = calloc(1, sizeof(T_SPI_ASYNC))) == NULL) {
+		perror("calloc");
+		return E_OBJ;
+	}
+	if ((async->cells = malloc(sizeof(T_SPI_REQUEST) * num)) == NULL) {
+		perror("malloc");
+		free(async);
 		return E_OBJ;
 	}
+	for (i = 0; i < num; i++) {
+		async->cells[i].seq = i;
+	}
+	async->mask = num - 1U;
 
-	/* set default bits per word */
-	if (rpiSpiSetBitsPerWord(g_spi_bits_per_word) != E_OK) {
-		fprintf(stderr, "rpiSpiSetBitsPerWord failed\n");
+	if ((async->efd = eventfd(0, EFD_CLOEXEC)) == -1) {
+		perror("eventfd");
+		free(async->cells);
+		free(async);
 		return E_OBJ;
 	}
+	sem_init(&async->pending, 0, 0);
 
-	/* set default CS polarity */
-	if (rpiSpiSetCsPolarity(g_spi_cs_polarity) != E_OK) {
-		fprintf(stderr, "rpiSpiSetCsPolarity failed\n");
+	dev->async = async;
+	if ((ret = pthread_create(&async->thread, NULL, sRpiSpiWorker, dev)) != 0) {
+		errno = ret;
+		perror("pthread_create");
+		dev->async = NULL;
+		sem_destroy(&async->pending);
+		close(async->efd);
+		free(async->cells);
+		free(async);
 		return E_OBJ;
 	}
 
@@ -97,153 +831,528 @@ int8_t rpiSpiOpen(uint8_t *dev_path)
 }
 
 /**
- * @brief SPI Port Close
+ * @brief Stop Asynchronous Transfer
  *
- * @param Nothing
+ * Waits until the queued requests are completed, then stops the worker thread.
+ * Nothing is done if asynchronous transfer is not started.
+ *
+ * @param [in]	dev		SPI device handle
  *
  * @retval E_OK		success
- * @retval E_OBJ	failure (object error)
  */
-int8_t rpiSpiClose()
+int8_t rpiSpiDevAsyncStop(T_SPI_DEV *dev)
 {
-	/* check port */
-	assert(g_spi_fd != D_FD_NOT_OPENED);
+	T_SPI_ASYNC *async;
 
-	/* close SPI port */
-	if (close(g_spi_fd) == -1) {
-		perror("close");
-		return E_OBJ;
+	/* check parameter */
+	assert(dev != NULL);
+
+	if ((async = dev->async) == NULL) {
+		return E_OK;
 	}
 
-	/* clear file descriptor */
-	g_spi_fd = D_FD_NOT_OPENED;
+	/* stop request (posts without a request) */
+	sem_post(&async->pending);
+	pthread_join(async->thread, NULL);
+
+	dev->async = NULL;
+	sem_destroy(&async->pending);
+	close(async->efd);
+	free(async->cells);
+	free(async);
 
 	return E_OK;
 }
 
 /**
- * @brief SPI Data Transfer
+ * @brief Queue Asynchronous Transfer
  *
- * @param [in]	tx_data		address of write data buffer
- * @param [out]	rx_data		address of read data buffer
- * @param [in]	size		buffer size
+ * Never blocks (lock-free, can be called from several threads).
+ * The segment is copied, but its buffers must be kept until completion.
+ * Each request is transferred in its own CS frame: CS is asserted for the segment
+ * and deasserted after it, even if the worker merges several requests into one message.
+ * On completion, the callback is called by the worker thread, and the eventfd
+ * (rpiSpiDevGetEventFd()) is incremented.
+ *
+ * @param [in]	dev			SPI device handle (asynchronous transfer started)
+ * @param [in]	seg			segment (cs_change is ignored)
+ * @param [in]	callback	completion callback (NULL: not used)
+ * @param [in]	arg			argument of callback
  *
  * @retval E_OK		success
- * @retval E_OBJ	failure (object error)
+ * @retval E_OBJ	failure (queue is full)
  */
-int8_t rpiSpiTransfer(uint8_t *tx_data, uint8_t *rx_data, uint32_t size)
+int8_t rpiSpiDevSubmit(T_SPI_DEV *dev, const T_SPI_SEGMENT *seg, T_SPI_CALLBACK callback, void *arg)
 {
+	T_SPI_ASYNC *async;
+	T_SPI_REQUEST *cell;
+	uint32_t pos, seq;
+
 	/* check parameter */
-	assert(tx_data != NULL);
-	assert(rx_data != NULL);
-	assert(size > 0);
+	assert(dev != NULL);
+	assert(dev->async != NULL);
+	assert(seg != NULL);
+	assert((seg->tx != NULL) || (seg->rx != NULL));
+	assert(seg->len > 0);
 
-	struct spi_ioc_transfer msg = {
-		.tx_buf        = (unsigned long)tx_data,
-		.rx_buf        = (unsigned long)rx_data,
-		.len           = size,
-		.speed_hz      = g_spi_speed,
-		.delay_usecs   = g_spi_delay,
-		.bits_per_word = g_spi_bits_per_word,
-		.cs_change     = g_spi_cs_polarity,
-	};
-
-	/* transfer data */
-	if (ioctl(g_spi_fd, SPI_IOC_MESSAGE(1), &msg) == -1) {
-		perror("ioctl");
-		return E_OBJ;
+	async = dev->async;
+
+	/* reserve a cell */
+	pos = __atomic_load_n(&async->head, __ATOMIC_RELAXED);
+	for (;;) {
+		cell = &async->cells[pos & async->mask];
+		seq  = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		if (seq == pos) {
+			if (__atomic_compare_exchange_n(&async->head, &pos, pos + 1U, 1,
+											__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if ((int32_t)(seq - pos) < 0) {
+			return E_OBJ;
+		} else {
+			pos = __atomic_load_n(&async->head, __ATOMIC_RELAXED);
+		}
 	}
 
+	/* publish the request */
+	cell->seg      = *seg;
+	cell->callback = callback;
+	cell->arg      = arg;
+	__atomic_store_n(&cell->seq, pos + 1U, __ATOMIC_RELEASE);
+
+	sem_post(&async->pending);
+
 	return E_OK;
 }
 
 /**
- * @brief SPI Mode Setting
+ * @brief Getter of Completion eventfd
  *
- * @param [in]	mode	SPI mode
- *		@arg SPI_MODE_0		CPOL: positive logic, CPHA: positive edge
- *		@arg SPI_MODE_1		CPOL: positive logic, CPHA: negative edge
- *		@arg SPI_MODE_2		CPOL: negative logic, CPHA: positive edge
- *		@arg SPI_MODE_3		CPOL: negative logic, CPHA: negative edge
+ * Each read() of the eventfd returns the number of completed requests since the last read().
+ *
+ * @param [in]	dev		SPI device handle (asynchronous transfer started)
+ *
+ * @return eventfd
+ */
+int rpiSpiDevGetEventFd(T_SPI_DEV *dev)
+{
+	/* check parameter */
+	assert(dev != NULL);
+	assert(dev->async != NULL);
+
+	return dev->async->efd;
+}
+
+/**
+ * @brief Acquire Buffer from Pool (handle)
+ *
+ * Each handle has D_SPI_POOL_NUM page aligned buffers of bufsiz (rounded up to page size),
+ * allocated at open, so that transfers need no heap allocation.
+ * Lock-free (can be called from several threads and from completion callbacks).
+ *
+ * @param [in]	dev		SPI device handle
+ * @param [out]	buf		address of buffer
+ * @param [out]	size	size of buffer (NULL: not used)
  *
  * @retval E_OK		success
- * @retval E_OBJ	failure (object error)
+ * @retval E_OBJ	failure (all buffers are acquired)
  */
-int8_t rpiSpiSetMode(uint8_t mode)
+int8_t rpiSpiDevBufAcquire(T_SPI_DEV *dev, uint8_t **buf, uint32_t *size)
 {
-	uint8_t mode_tmp;
+	uint32_t map, idx;
 
 	/* check parameter */
-	assert(M_CHECK_MODE(mode));
+	assert(dev != NULL);
+	assert(dev->pool != NULL);
+	assert(buf != NULL);
 
-	/* set SPI mode for read-direction */
-	mode_tmp = mode;
-	if (ioctl(g_spi_fd, SPI_IOC_RD_MODE, &mode_tmp) == -1) {
-		perror("ioctl");
+	map = __atomic_load_n(&dev->pool_map, __ATOMIC_RELAXED);
+	do {
+		if ((~map & ((1ULL << D_SPI_POOL_NUM) - 1U)) == 0U) {
+			return E_OBJ;
+		}
+		idx = __builtin_ctz(~map);
+	} while (!__atomic_compare_exchange_n(&dev->pool_map, &map, map | (1U << idx), 1,
+										  __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+	*buf = dev->pool + (size_t)dev->pool_size * idx;
+	if (size != NULL) {
+		*size = dev->pool_size;
+	}
+
+	return E_OK;
+}
+
+/**
+ * @brief Release Buffer to Pool (handle)
+ *
+ * @param [in]	dev		SPI device handle
+ * @param [in]	buf		address of buffer (acquired by rpiSpiDevBufAcquire())
+ *
+ * @retval E_OK		success
+ */
+int8_t rpiSpiDevBufRelease(T_SPI_DEV *dev, uint8_t *buf)
+{
+	uint32_t idx;
+
+	/* check parameter */
+	assert(dev != NULL);
+	assert(buf != NULL);
+	assert((buf >= dev->pool) && (buf < dev->pool + (size_t)dev->pool_size * D_SPI_POOL_NUM));
+	assert((buf - dev->pool) % dev->pool_size == 0);
+
+	idx = (buf - dev->pool) / dev->pool_size;
+	assert(dev->pool_map & (1U << idx));
+
+	__atomic_fetch_and(&dev->pool_map, ~(1U << idx), __ATOMIC_RELEASE);
+
+	return E_OK;
+}
+
+/*------------------------------------------------------------------------------
+	Functions (Internal)
+------------------------------------------------------------------------------*/
+/**
+ * @brief Open SPI Port of Handle
+ *
+ * @param [in]	dev			SPI device handle (locked, not opened)
+ * @param [in]	dev_path	string of path for device node
+ *
+ * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
+ */
+static int8_t sRpiSpiOpen(T_SPI_DEV *dev, uint8_t *dev_path)
+{
+	long page;
+
+	M_INSTRUMENT_FUNC(SPI_OPEN);
+
+	/* open SPI port */
+	if ((dev->fd = open((const char *)dev_path, O_RDWR)) == -1) {
+		perror("open");
 		return E_OBJ;
 	}
 
-	/* set SPI mode for write-direction */
-	mode_tmp = mode;
-	if (ioctl(g_spi_fd, SPI_IOC_WR_MODE, &mode_tmp) == -1) {
-		perror("ioctl");
+	/* maximum bytes of a message */
+	dev->bufsiz = sRpiSpiReadBufsiz();
+
+	/* allocate buffer pool (page aligned, pre-faulted) */
+	page = sysconf(_SC_PAGESIZE);
+	dev->pool_size = (dev->bufsiz + page - 1) / page * page;
+	dev->pool_map  = 0U;
+	dev->pool = mmap(NULL, (size_t)dev->pool_size * D_SPI_POOL_NUM, PROT_READ | PROT_WRITE,
+					 MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+	if (dev->pool == MAP_FAILED) {
+		perror("mmap");
+		dev->pool = NULL;
+		close(dev->fd);
+		dev->fd = D_FD_NOT_OPENED;
+		return E_OBJ;
+	}
+
+	/* apply all settings */
+	dev->hw_valid = 0U;
+	if (sRpiSpiApply(dev) != E_OK) {
+		fprintf(stderr, "sRpiSpiApply failed\n");
+		munmap(dev->pool, (size_t)dev->pool_size * D_SPI_POOL_NUM);
+		dev->pool = NULL;
+		close(dev->fd);
+		dev->fd = D_FD_NOT_OPENED;
 		return E_OBJ;
 	}
 
-	g_spi_mode = mode;
 	return E_OK;
 }
 
 /**
- * @brief SPI Transfer Speed Setting
+ * @brief Close SPI Port of Handle
  *
- * @param [in]	speed	transfer speed
+ * @param [in]	dev		SPI device handle (locked, opened)
  *
  * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
  */
-int8_t rpiSpiSetSpeed(uint32_t speed)
+static int8_t sRpiSpiClose(T_SPI_DEV *dev)
 {
-	g_spi_speed = speed;
+	M_INSTRUMENT_FUNC(SPI_CLOSE);
+
+	/* release buffer pool (buffers must not be used any more) */
+	munmap(dev->pool, (size_t)dev->pool_size * D_SPI_POOL_NUM);
+	dev->pool = NULL;
+
+	/* close SPI port */
+	if (close(dev->fd) == -1) {
+		perror("close");
+		return E_OBJ;
+	}
+
+	/* clear file descriptor */
+	dev->fd = D_FD_NOT_OPENED;
+
 	return E_OK;
 }
 
 /**
- * @brief SPI Transfer Delay Time Setting
+ * @brief Apply Active Settings to spidev
  *
- * @param [in]	delay	transfer delay time (usec)
+ * Issues only the ioctls whose values differ from the applied ones.
+ * Nothing is done if the port is not opened (applied at open).
+ *
+ * @param [in]	dev		SPI device handle (locked)
  *
  * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
  */
-int8_t rpiSpiSetDelay(uint16_t delay)
+static int8_t sRpiSpiApply(T_SPI_DEV *dev)
 {
-	g_spi_delay = delay;
+	uint8_t mode;
+	uint32_t speed;
+	uint8_t bits;
+
+	if (dev->fd == D_FD_NOT_OPENED) {
+		return E_OK;
+	}
+
+	/* SPI mode and CS polarity */
+	if (!dev->hw_valid || (dev->conf.mode != dev->hw.mode) || (dev->conf.cs_polarity != dev->hw.cs_polarity)) {
+		mode = dev->conf.mode | ((dev->conf.cs_polarity == D_SPI_CS_POS_LOGIC) ? SPI_CS_HIGH : 0U);
+		if (ioctl(dev->fd, SPI_IOC_WR_MODE, &mode) == -1) {
+			perror("ioctl");
+			dev->hw_valid = 0U;
+			return E_OBJ;
+		}
+		dev->hw.mode        = dev->conf.mode;
+		dev->hw.cs_polarity = dev->conf.cs_polarity;
+	}
+
+	/* transfer speed (used if speed of transfer is 0) */
+	if (!dev->hw_valid || (dev->conf.speed != dev->hw.speed)) {
+		speed = dev->conf.speed;
+		if (ioctl(dev->fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) {
+			perror("ioctl");
+			dev->hw_valid = 0U;
+			return E_OBJ;
+		}
+		dev->hw.speed = dev->conf.speed;
+	}
+
+	/* bits per word */
+	if (!dev->hw_valid || (dev->conf.bits_per_word != dev->hw.bits_per_word)) {
+		bits = dev->conf.bits_per_word;
+		if (ioctl(dev->fd, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1) {
+			perror("ioctl");
+			dev->hw_valid = 0U;
+			return E_OBJ;
+		}
+		dev->hw.bits_per_word = dev->conf.bits_per_word;
+	}
+
+	dev->hw_valid = 1U;
+
 	return E_OK;
 }
 
 /**
- * @brief SPI Bits per Word Setting
+ * @brief Transfer Segments in as Few Messages as Possible
  *
- * @param [in]	len		bit length per a word
+ * Each message holds up to D_SPI_MSG_MAX transfers and up to bufsiz bytes for each direction,
+ * where spidev counts each transfer rounded up to D_SPI_ALIGN bytes.
+ * Segments larger than bufsiz are split into chunks of whole words.
+ * The last transfer of each message except the final one gets inverted cs_change,
+ * so that CS is kept asserted (or deasserted as requested by the segment) across messages.
+ *
+ * @param [in]	dev		SPI device handle (locked)
+ * @param [in]	segs	segments
+ * @param [in]	num		number of segments
  *
  * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
  */
-int8_t rpiSpiSetBitsPerWord(uint8_t len)
+static int8_t sRpiSpiTransferSegs(T_SPI_DEV *dev, const T_SPI_SEGMENT *segs, uint32_t num)
 {
-	g_spi_bits_per_word = len;
-	return E_OK;
+	struct spi_ioc_transfer xfer[D_SPI_MSG_MAX];
+	uint32_t i, n, off, len, chunk, tx_total, rx_total;
+	uint8_t bits;
+
+	n = 0;
+	tx_total = 0;
+	rx_total = 0;
+	for (i = 0; i < num; i++) {
+		bits = (segs[i].bits != 0U) ? segs[i].bits : dev->conf.bits_per_word;
+
+		/* largest chunk within bufsiz after alignment (whole words of 1, 2 or 4 bytes) */
+		chunk = dev->bufsiz & ~(D_SPI_ALIGN - 1U);
+
+		for (off = 0; off < segs[i].len; off += len) {
+			len = segs[i].len - off;
+			if (len > chunk) {
+				len = chunk;
+			}
+
+			/* submit previous transfers if this one exceeds the limits */
+			if ((n == D_SPI_MSG_MAX) ||
+				((segs[i].tx != NULL) && (tx_total + M_SPI_ALIGN(len) > dev->bufsiz)) ||
+				((segs[i].rx != NULL) && (rx_total + M_SPI_ALIGN(len) > dev->bufsiz))) {
+				xfer[n - 1].cs_change ^= 1U;
+				if (sRpiSpiSubmit(dev, xfer, n) != E_OK) {
+					return E_OBJ;
+				}
+				n = 0;
+				tx_total = 0;
+				rx_total = 0;
+			}
+
+			memset(&xfer[n], 0, sizeof(xfer[n]));
+			xfer[n].tx_buf        = (segs[i].tx != NULL) ? (unsigned long)(segs[i].tx + off) : 0UL;
+			xfer[n].rx_buf        = (segs[i].rx != NULL) ? (unsigned long)(segs[i].rx + off) : 0UL;
+			xfer[n].len           = len;
+			xfer[n].speed_hz      = (segs[i].speed != 0U) ? segs[i].speed : dev->conf.speed;
+			xfer[n].bits_per_word = bits;
+			if (off + len == segs[i].len) {
+				/* delay and cs_change after the last chunk of the segment */
+				xfer[n].delay_usecs = segs[i].delay;
+				xfer[n].cs_change   = segs[i].cs_change;
+			}
+			tx_total += (segs[i].tx != NULL) ? M_SPI_ALIGN(len) : 0U;
+			rx_total += (segs[i].rx != NULL) ? M_SPI_ALIGN(len) : 0U;
+			n++;
+		}
+	}
+
+	return sRpiSpiSubmit(dev, xfer, n);
 }
 
 /**
- * @brief SPI CS Polarity Setting
+ * @brief Submit Transfers as a Message
  *
- * @param [in]	pol		CS polarity
- *		@arg D_SPI_CS_POS_LOGIC		positive logic
- *		@arg D_SPI_CS_NEG_LOGIC		negative logic
+ * @param [in]	dev		SPI device handle (locked)
+ * @param [in]	xfer	transfers
+ * @param [in]	num		number of transfers (1 - D_SPI_MSG_MAX)
  *
  * @retval E_OK		success
+ * @retval E_OBJ	failure (object error)
  */
-int8_t rpiSpiSetCsPolarity(uint8_t pol)
+static int8_t sRpiSpiSubmit(T_SPI_DEV *dev, struct spi_ioc_transfer *xfer, uint32_t num)
 {
-	g_spi_cs_polarity = pol;
+	if (ioctl(dev->fd, SPI_IOC_MESSAGE(num), xfer) == -1) {
+		perror("ioctl");
+		return E_OBJ;
+	}
+
 	return E_OK;
 }
+
+/**
+ * @brief Read bufsiz Parameter of spidev
+ *
+ * @param nothing
+ *
+ * @return maximum bytes of a message (D_SPI_BUFSIZ if the parameter is not available)
+ */
+static uint32_t sRpiSpiReadBufsiz()
+{
+	FILE *fp;
+	unsigned int bufsiz;
+
+	if ((fp = fopen(D_SPI_BUFSIZ_PATH, "r")) == NULL) {
+		return D_SPI_BUFSIZ;
+	}
+
+	if ((fscanf(fp, "%u", &bufsiz) != 1) || (bufsiz < D_SPI_ALIGN)) {
+		bufsiz = D_SPI_BUFSIZ;
+	}
+	fclose(fp);
+
+	return bufsiz;
+}
+
+/**
+ * @brief Worker Thread of Asynchronous Transfer
+ *
+ * @param [in]	arg		SPI device handle
+ *
+ * @return NULL
+ */
+static void *sRpiSpiWorker(void *arg)
+{
+	T_SPI_DEV *dev = (T_SPI_DEV *)arg;
+	T_SPI_ASYNC *async = dev->async;
+	T_SPI_REQUEST req[D_SPI_ASYNC_MERGE];
+	T_SPI_SEGMENT segs[D_SPI_ASYNC_MERGE];
+	uint32_t i, n;
+	uint64_t done;
+	int8_t ret;
+
+	for (;;) {
+		while (sem_wait(&async->pending) == -1);
+
+		/* merge the queued requests (each of them has posted the semaphore) */
+		n = 0;
+		if (sRpiSpiDequeue(async, &req[n])) {
+			n++;
+			while ((n < D_SPI_ASYNC_MERGE) && (sem_trywait(&async->pending) == 0)) {
+				if (!sRpiSpiDequeue(async, &req[n])) {
+					/* the stop request has posted */
+					sem_post(&async->pending);
+					break;
+				}
+				n++;
+			}
+		} else {
+			/* only the stop request posts without a request */
+			break;
+		}
+
+		/* one CS frame per request: deassert CS between requests and release it after the last one */
+		for (i = 0; i < n; i++) {
+			segs[i] = req[i].seg;
+			segs[i].cs_change = (i < n - 1) ? 1U : 0U;
+		}
+
+		pthread_mutex_lock(&dev->lock);
+		ret = sRpiSpiTransferSegs(dev, segs, n);
+		pthread_mutex_unlock(&dev->lock);
+
+		/* notify completion */
+		for (i = 0; i < n; i++) {
+			if (req[i].callback != NULL) {
+				req[i].callback(dev, &req[i].seg, ret, req[i].arg);
+			}
+		}
+		done = n;
+		if (write(async->efd, &done, sizeof(done)) == -1) {
+			perror("write");
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Dequeue Request of Asynchronous Transfer (worker only)
+ *
+ * If the next cell is reserved but not published yet, waits for the producer.
+ *
+ * @param [in]	async	asynchronous transfer context
+ * @param [out]	req		request
+ *
+ * @retval 1	dequeued
+ * @retval 0	queue is empty
+ */
+static uint8_t sRpiSpiDequeue(T_SPI_ASYNC *async, T_SPI_REQUEST *req)
+{
+	T_SPI_REQUEST *cell = &async->cells[async->tail & async->mask];
+
+	while (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != async->tail + 1U) {
+		if (__atomic_load_n(&async->head, __ATOMIC_RELAXED) == async->tail) {
+			return 0;
+		}
+		sched_yield();
+	}
+
+	*req = *cell;
+	__atomic_store_n(&cell->seq, async->tail + async->mask + 1U, __ATOMIC_RELEASE);
+	async->tail++;
+
+	return 1;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file		regmap_stress.c
+ * @brief		Stress Test of Concurrency-Safe Register Map
+ *
+ * Many threads update fields sharing GPFSEL, CM_GPnCTL and CM_GPnDIV registers
+ * of the simulated register backend at the same time, and check that no update
+ * is lost (each thread owns its fields and reads back what it has written).
+ *
+ * @author		T. Ngtk
+ * @copyright	Copyright (c) 2016 T. Ngtk
+ *
+ * @par License
+ *	Released under the MIT License.<BR>
+ *	https://github.com/ngtkt0909/raspberry-pi-gpio/blob/master/LICENSE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "rpi_regmap.h"
+
+/*------------------------------------------------------------------------------
+	Defined Macros
+------------------------------------------------------------------------------*/
+#define D_STRESS_LOOP		(100000)	/**< number of updates per thread */
+#define D_STRESS_PIN_NUM	(30)		/**< GPIO pins 0 - 29 (GPFSEL0 - GPFSEL2) */
+#define D_STRESS_TXN_PIN	(29)		/**< GPIO pin updated by transactions */
+#define D_STRESS_TXN_CH		(2)			/**< channel whose CM_GPnDIV.DIVF is updated by transactions */
+#define D_STRESS_CH_NUM		(3)			/**< clock manager channels */
+
+/*------------------------------------------------------------------------------
+	Type Definition
+------------------------------------------------------------------------------*/
+/** @brief field owned by a thread */
+typedef enum e_stress_field {
+	E_STRESS_FSEL = 0,		/**< GPFSEL.FSEL of pin */
+	E_STRESS_MASH,			/**< CM_GPnCTL.MASH of channel */
+	E_STRESS_SRC,			/**< CM_GPnCTL.SRC of channel */
+	E_STRESS_DIVI,			/**< CM_GPnDIV.DIVI of channel */
+	E_STRESS_DIVF,			/**< CM_GPnDIV.DIVF of channel */
+	E_STRESS_TXN,			/**< GPFSEL.FSEL of pin and CM_GPnDIV.DIVF of channel by transactions */
+} E_STRESS_FIELD;
+
+/** @brief stress thread */
+typedef struct t_stress_thread {
+	pthread_t		thread;		/**< thread */
+	E_STRESS_FIELD	field;		/**< owned field */
+	uint8_t			idx;		/**< pin or channel */
+	uint32_t		last;		/**< last written value */
+	uint32_t		errors;		/**< number of lost updates */
+} T_STRESS_THREAD;
+
+/*------------------------------------------------------------------------------
+	Prototype Declaration
+------------------------------------------------------------------------------*/
+static uint32_t sStressRun(uint8_t shadow);
+static void *sStressThread(void *arg);
+static uint32_t sStressValue(E_STRESS_FIELD field, uint32_t i);
+static uint32_t sStressRead(E_STRESS_FIELD field, uint8_t idx);
+
+/*------------------------------------------------------------------------------
+	Functions
+------------------------------------------------------------------------------*/
+/**
+ * @brief Main
+ *
+ * @param nothing
+ *
+ * @retval EXIT_SUCCESS	no update is lost
+ * @retval EXIT_FAILURE	one or more updates are lost
+ */
+int main()
+{
+	uint32_t errors;
+
+	if (rpiRegmapInitSim(NULL) != E_OK) {
+		return EXIT_FAILURE;
+	}
+	rpiRegmapLockEnable(1U);
+
+	errors  = sStressRun(D_RPI_SHADOW_OFF);
+	errors += sStressRun(D_RPI_SHADOW_ON);
+
+	printf("regmap_stress: %s (%u lost updates)\n", (errors == 0U) ? "OK" : "NG", errors);
+
+	return (errors == 0U) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Run Stress Threads
+ *
+ * @param [in]	shadow	mode of shadow cache
+ *
+ * @return number of lost updates
+ */
+static uint32_t sStressRun(uint8_t shadow)
+{
+	T_STRESS_THREAD th[D_STRESS_PIN_NUM + D_STRESS_CH_NUM * 4];
+	uint32_t n = 0, i, errors = 0;
+	uint8_t ch;
+
+	if (rpiRegmapShadowEnable(shadow) != E_OK) {
+		return 1U;
+	}
+
+	/* every pin of GPFSEL0 - GPFSEL2 (the last one by transactions) */
+	for (i = 0; i < D_STRESS_PIN_NUM; i++) {
+		th[n].field = (i == D_STRESS_TXN_PIN) ? E_STRESS_TXN : E_STRESS_FSEL;
+		th[n].idx   = (uint8_t)i;
+		n++;
+	}
+
+	/* every field of CM_GPnCTL and CM_GPnDIV */
+	for (ch = 0; ch < D_STRESS_CH_NUM; ch++) {
+		th[n].field = E_STRESS_MASH;
+		th[n++].idx = ch;
+		th[n].field = E_STRESS_SRC;
+		th[n++].idx = ch;
+		th[n].field = E_STRESS_DIVI;
+		th[n++].idx = ch;
+		if (ch != D_STRESS_TXN_CH) {
+			th[n].field = E_STRESS_DIVF;
+			th[n++].idx = ch;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		th[i].errors = 0;
+		if (pthread_create(&th[i].thread, NULL, sStressThread, &th[i]) != 0) {
+			perror("pthread_create");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* final values must be the last written ones */
+	for (i = 0; i < n; i++) {
+		pthread_join(th[i].thread, NULL);
+		errors += th[i].errors;
+		if (sStressRead(th[i].field, th[i].idx) != th[i].last) {
+			errors++;
+		}
+	}
+
+	rpiRegmapShadowEnable(D_RPI_SHADOW_OFF);
+
+	return errors;
+}
+
+/**
+ * @brief Stress Thread
+ *
+ * @param [in]	arg		stress thread
+ *
+ * @return NULL
+ */
+static void *sStressThread(void *arg)
+{
+	T_STRESS_THREAD *th = (T_STRESS_THREAD *)arg;
+	T_RPI_REGMAP_TXN txn;
+	uint32_t i, val;
+
+	for (i = 0; i < D_STRESS_LOOP; i++) {
+		val = sStressValue(th->field, i);
+
+		switch (th->field) {
+		case E_STRESS_FSEL:
+			rpiRegmapWriteGpfselFsel(th->idx, val);
+			break;
+		case E_STRESS_MASH:
+			rpiRegmapWriteCmGpctlMash(th->idx, val);
+			break;
+		case E_STRESS_SRC:
+			rpiRegmapWriteCmGpctlSrc(th->idx, val);
+			break;
+		case E_STRESS_DIVI:
+			rpiRegmapWriteCmGpdivDivi(th->idx, val);
+			break;
+		case E_STRESS_DIVF:
+			rpiRegmapWriteCmGpdivDivf(th->idx, val);
+			break;
+		case E_STRESS_TXN:
+			rpiRegmapTxnBegin(&txn);
+			rpiRegmapQueueGpfselFsel(&txn, th->idx, val);
+			rpiRegmapQueueCmGpdivDivf(&txn, D_STRESS_TXN_CH, val);
+			rpiRegmapTxnCommit(&txn);
+			if (rpiRegmapReadCmGpdivDivf(D_STRESS_TXN_CH) != val) {
+				th->errors++;
+			}
+			break;
+		}
+
+		/* own field is never overwritten by the others */
+		if (sStressRead(th->field, th->idx) != val) {
+			th->errors++;
+		}
+		th->last = val;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Value of Field for Iteration
+ *
+ * @param [in]	field	field
+ * @param [in]	i		iteration
+ *
+ * @return value of field
+ */
+static uint32_t sStressValue(E_STRESS_FIELD field, uint32_t i)
+{
+	switch (field) {
+	case E_STRESS_MASH:
+		return i & 0x3U;
+	case E_STRESS_DIVI:
+	case E_STRESS_DIVF:
+		return i & 0xFFFU;
+	default:
+		return i & 0x7U;	/* FSEL, SRC */
+	}
+}
+
+/**
+ * @brief Read Field
+ *
+ * @param [in]	field	field
+ * @param [in]	idx		pin or channel
+ *
+ * @return value of field
+ */
+static uint32_t sStressRead(E_STRESS_FIELD field, uint8_t idx)
+{
+	switch (field) {
+	case E_STRESS_MASH:
+		return rpiRegmapReadCmGpctlMash(idx);
+	case E_STRESS_SRC:
+		return rpiRegmapReadCmGpctlSrc(idx);
+	case E_STRESS_DIVI:
+		return rpiRegmapReadCmGpdivDivi(idx);
+	case E_STRESS_DIVF:
+		return rpiRegmapReadCmGpdivDivf(idx);
+	default:
+		return rpiRegmapReadGpfselFsel(idx);	/* FSEL, TXN */
+	}
+}